@@ -28,6 +28,7 @@
 #include "accumulator.h"
 #include "utils.h"
 #include "incbin.h"
+#include "../profiler.h"
 
 INCBIN_EXTERN (network);
 
@@ -99,6 +100,8 @@ public:
         const std::uint8_t color,
         const std::uint8_t square,
         const bool operation) {
+        PROFILE_SCOPE(ACCUMULATOR);
+
         // Calculate the stride necessary to get to the correct piece:
         const std::uint16_t pieceIndex = piece * whiteSquares;
 
@@ -117,6 +120,8 @@ public:
     }
 
     [[nodiscard]] std::int32_t evaluate(const std::uint8_t sideToMove, const int pieces) const {
+        PROFILE_SCOPE(FORWARD);
+
         // Calculate the bucket based on the number of pieces on the board
         const int bucket = (pieces - 2) / ((32 + outputSize - 1) / outputSize);
 
@@ -0,0 +1,105 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "allocations.h"
+
+#ifdef COUNT_ALLOCATIONS
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// The replacements live in their own file, so they are never inlined into a caller.
+// Every plain, array, aligned and nothrow form goes through the same counter
+namespace {
+    thread_local std::uint64_t threadAllocations = 0;
+
+    void *countedAllocate(const std::size_t size, const std::size_t alignment) {
+        threadAllocations++;
+
+        // aligned_alloc needs the size to be a multiple of the alignment
+        const std::size_t alignedSize = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+        return alignment <= alignof(std::max_align_t)
+                   ? std::malloc(std::max<std::size_t>(size, 1))
+                   : std::aligned_alloc(alignment, alignedSize);
+    }
+
+    // malloc and aligned_alloc are both released with free
+    void countedFree(void *pointer) noexcept {
+        std::free(pointer);
+    }
+}
+
+std::uint64_t getThreadAllocations() {
+    return threadAllocations;
+}
+
+void *operator new(const std::size_t size) {
+    if (void *pointer = countedAllocate(size, alignof(std::max_align_t))) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](const std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment) {
+    if (void *pointer = countedAllocate(size, static_cast<std::size_t>(alignment))) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void *operator new(const std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](const std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(pointer); }
+
+#endif
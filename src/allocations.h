@@ -0,0 +1,36 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstdint>
+
+// Counts the heap allocations of every thread, datagen uses it to report the allocations per game.
+// Replacing the global allocator affects the whole binary, so it's only compiled in with COUNT_ALLOCATIONS
+// (make allocs). Without it the count is always zero
+#ifdef COUNT_ALLOCATIONS
+std::uint64_t getThreadAllocations();
+#else
+inline std::uint64_t getThreadAllocations() {
+    return 0;
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "analyse.h"
+#include "book.h"
+#include "search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    bool parseNumber(const std::string &value, std::uint64_t &number) {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        number = std::stoull(value);
+        return true;
+    }
+
+    std::string scoreToString(const int score) {
+        if (score >= EVAL_MATE_IN_MAX_PLY) {
+            return "mate " + std::to_string((EVAL_MATE - score) / 2 + 1);
+        }
+        if (score <= -EVAL_MATE_IN_MAX_PLY) {
+            return "mate " + std::to_string(-(EVAL_MATE + score) / 2);
+        }
+        return "cp " + std::to_string(score);
+    }
+}
+
+bool parseAnalyseConfig(std::istream &args, AnalyseConfig &config) {
+    std::string token;
+    while (args >> token) {
+        const std::size_t separator = token.find('=');
+        if (separator == std::string::npos) {
+            if (!config.path.empty()) {
+                std::cerr << "Expected key=value but got '" << token << "'" << std::endl;
+                return false;
+            }
+            config.path = token;
+            continue;
+        }
+
+        const std::string key = token.substr(0, separator);
+        const std::string value = token.substr(separator + 1);
+
+        if (key == "out") {
+            config.out = value;
+            continue;
+        }
+
+        std::uint64_t number = 0;
+        if (!parseNumber(value, number)) {
+            std::cerr << "Invalid value for " << key << ": '" << value << "'" << std::endl;
+            return false;
+        }
+
+        if (key == "depth") {
+            config.depth = std::clamp(static_cast<int>(number), 1, MAX_PLY - 1);
+        } else if (key == "nodes") {
+            config.nodes = std::max<std::uint64_t>(1, number);
+        } else if (key == "movetime") {
+            config.movetime = std::max(1, static_cast<int>(number));
+        } else if (key == "threads") {
+            config.threads = std::max(1, static_cast<int>(number));
+        } else if (key == "hash") {
+            config.hash = std::max(1, static_cast<int>(number));
+        } else {
+            std::cerr << "Unknown analyse option '" << key << "'" << std::endl;
+            return false;
+        }
+    }
+
+    if (config.path.empty()) {
+        std::cerr << "Usage: analyse <file.epd> depth=N|nodes=N|movetime=N threads=T hash=MB out=<file>" << std::endl;
+        return false;
+    }
+
+    if (config.depth == 0 && config.nodes == 0 && config.movetime == 0) {
+        config.depth = 10;
+    }
+    return true;
+}
+
+void runAnalyse(const AnalyseConfig &config) {
+    OpeningBook book;
+    if (!book.load(config.path)) {
+        return;
+    }
+
+    std::ofstream outputFile;
+    if (!config.out.empty()) {
+        outputFile.open(config.out);
+        if (!outputFile.is_open()) {
+            std::cerr << "Could not open " << config.out << " for the analysis" << std::endl;
+            return;
+        }
+    }
+    std::ostream &output = config.out.empty() ? std::cout : outputFile;
+
+    const int threads = static_cast<int>(std::min<std::size_t>(config.threads, book.size()));
+
+    // The results are written in the order of the file. A finished result waits
+    // here until every position in front of it is written
+    std::vector<std::string> results(book.size());
+    std::vector<bool> isFinished(book.size());
+    std::size_t nextToWrite = 0;
+    std::mutex outputMutex;
+
+    std::atomic<std::size_t> nextPosition{0};
+    std::atomic<std::uint64_t> totalNodes{0};
+
+    const std::chrono::time_point start = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        tt transpositionTable(config.hash);
+        TimeManagement timeManagement;
+        const auto net = std::make_unique<Network>();
+        const auto search = std::make_unique<Search>(timeManagement, transpositionTable, *net);
+        search->initLMR();
+        search->resetHistory();
+
+        Board board(net.get());
+        SearchParams params;
+        params.minimal = true;
+
+        for (std::size_t i = nextPosition++; i < book.size(); i = nextPosition++) {
+            const std::string &fen = book.getOpening(i);
+            board.setFen(fen);
+
+            // The limits are reset by every search
+            timeManagement.reset();
+            params.depth = config.depth > 0 ? config.depth : MAX_PLY;
+            params.isInfinite = config.movetime == 0;
+            search->nodeLimit = config.nodes > 0 ? config.nodes : Search::NO_NODE_LIMIT;
+            if (config.movetime > 0) {
+                timeManagement.moveTime = config.movetime;
+                timeManagement.isInfiniteSearch = false;
+            }
+
+            const std::chrono::time_point positionStart = std::chrono::steady_clock::now();
+            search->iterativeDeepening(board, params);
+            const std::chrono::duration<double, std::milli> positionTime =
+                    std::chrono::steady_clock::now() - positionStart;
+
+            totalNodes += search->nodes;
+
+            // Mated and stalemated positions have no best move
+            const std::string bestMove = search->rootBestMove == Move::NULL_MOVE
+                                             ? "(none)"
+                                             : uci::moveToUci(search->rootBestMove, board.chess960());
+
+            std::string result = fen
+                                 + " | bestmove " + bestMove
+                                 + " | score " + scoreToString(search->currentScore)
+                                 + " | depth " + std::to_string(search->completedDepth)
+                                 + " | seldepth " + std::to_string(search->selDepth)
+                                 + " | nodes " + std::to_string(search->nodes)
+                                 + " | time " + std::to_string(static_cast<std::uint64_t>(positionTime.count()))
+                                 + " | pv " + search->getBestLine(board.chess960());
+
+            const std::lock_guard lock(outputMutex);
+            results[i] = std::move(result);
+            isFinished[i] = true;
+            while (nextToWrite < results.size() && isFinished[nextToWrite]) {
+                output << results[nextToWrite] << "\n";
+                std::string().swap(results[nextToWrite]);
+                nextToWrite++;
+            }
+            output.flush();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread: workers) {
+        thread.join();
+    }
+
+    const std::chrono::duration<double, std::milli> timeElapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "info string Analysed " << book.size() << " positions with " << threads << " threads | Nodes: "
+            << totalNodes << " | Time: " << static_cast<std::uint64_t>(timeElapsed.count()) << " ms | NPS: "
+            << static_cast<std::uint64_t>(totalNodes / (timeElapsed.count() + 1) * 1000) << std::endl;
+}
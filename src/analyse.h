@@ -0,0 +1,50 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANALYSE_H
+#define ANALYSE_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+// A batch analysis over the positions of an EPD or PGN file. Every worker thread keeps its own search,
+// net and hash for the whole run, so nothing is set up again between the positions
+struct AnalyseConfig {
+    std::string path;
+    std::string out; // Empty writes the results to the console
+
+    // The limits of every search, at least one is set. Without any limit a depth of 10 is used
+    int depth = 0;
+    std::uint64_t nodes = 0;
+    int movetime = 0;
+
+    int threads = 1;
+    int hash = 16; // In MB per thread
+};
+
+// Parses <file> followed by key=value arguments like depth=12 threads=8 out=results.txt.
+// Returns false on an unknown key or a bad value
+bool parseAnalyseConfig(std::istream &args, AnalyseConfig &config);
+
+// Analyses every position and writes one line per position in the order of the file:
+// <fen> | bestmove <move> | score cp <x> | depth <d> | seldepth <s> | nodes <n> | time <ms> | pv <moves>
+void runAnalyse(const AnalyseConfig &config);
+
+#endif
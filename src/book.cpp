@@ -0,0 +1,365 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "book.h"
+#include "consts.h"
+#include "NNUE/nnue.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+    // Checks the shape of the board field, so setFen never sees a broken position
+    bool isValidPlacement(const std::string_view placement) {
+        int rank = 0;
+        int file = 0;
+        for (const char c: placement) {
+            if (c == '/') {
+                if (file != 8) {
+                    return false;
+                }
+                rank++;
+                file = 0;
+            } else if (c >= '1' && c <= '8') {
+                file += c - '0';
+            } else if (std::string_view("pnbrqkPNBRQK").find(c) != std::string_view::npos) {
+                file++;
+            } else {
+                return false;
+            }
+
+            if (file > 8) {
+                return false;
+            }
+        }
+        return rank == 7 && file == 8;
+    }
+
+    // Both sides need exactly one king and the side that just moved can't be in check
+    bool isLegalPosition(const Board &board) {
+        return board.pieces(PieceType::KING, Color::WHITE).count() == 1 &&
+               board.pieces(PieceType::KING, Color::BLACK).count() == 1 &&
+               !board.isAttacked(board.kingSq(~board.sideToMove()), board.sideToMove());
+    }
+
+    bool isNumber(const std::string &token) {
+        return !token.empty() && token.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    bool isResult(const std::string_view token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    PieceType getPieceType(const char c) {
+        switch (c) {
+            case 'N': return PieceType::KNIGHT;
+            case 'B': return PieceType::BISHOP;
+            case 'R': return PieceType::ROOK;
+            case 'Q': return PieceType::QUEEN;
+            case 'K': return PieceType::KING;
+            default: return PieceType::NONE;
+        }
+    }
+}
+
+bool OpeningBook::load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the opening book " << path << std::endl;
+        return false;
+    }
+
+    openings.clear();
+
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".pgn") == 0) {
+        loadPgn(file);
+    } else {
+        loadEpd(file);
+    }
+
+    if (openings.empty()) {
+        std::cerr << "The opening book " << path << " doesn't contain any position" << std::endl;
+        return false;
+    }
+
+    std::cout << "info string Loaded " << openings.size() << " openings from " << path << std::endl;
+    return true;
+}
+
+void OpeningBook::loadEpd(std::istream &stream) {
+    const auto net = std::make_unique<Network>();
+    Board board(net.get());
+
+    std::string line;
+    std::uint64_t skipped = 0;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(line);
+        std::string placement, sideToMove, castling, enPassant;
+        if (!(fields >> placement >> sideToMove >> castling >> enPassant)) {
+            continue;
+        }
+
+        if (!isValidPlacement(placement) || (sideToMove != "w" && sideToMove != "b")) {
+            skipped++;
+            continue;
+        }
+
+        std::string fen = placement + " " + sideToMove + " " + castling + " " + enPassant;
+
+        // EPD lines usually carry operations instead of the move counters
+        std::string halfMoveClock, fullMoveNumber;
+        if (fields >> halfMoveClock >> fullMoveNumber && isNumber(halfMoveClock) && isNumber(fullMoveNumber)) {
+            fen += " " + halfMoveClock + " " + fullMoveNumber;
+        } else {
+            fen += " 0 1";
+        }
+
+        board.setFen(fen);
+        if (!isLegalPosition(board)) {
+            skipped++;
+            continue;
+        }
+
+        openings.push_back(fen);
+    }
+
+    if (skipped > 0) {
+        std::cerr << "Skipped " << skipped << " invalid positions of the opening book" << std::endl;
+    }
+}
+
+void OpeningBook::loadPgn(std::istream &stream) {
+    const auto net = std::make_unique<Network>();
+    Board board(net.get());
+
+    const std::string pgn((std::istreambuf_iterator(stream)), std::istreambuf_iterator<char>());
+
+    std::string startFen = STARTPOS;
+    bool hasMoves = false;
+    bool isBroken = false;
+    std::uint64_t skipped = 0;
+
+    auto startGame = [&](const std::string &fen) {
+        startFen = fen;
+        board.setFen(startFen);
+        hasMoves = false;
+        isBroken = false;
+    };
+
+    auto endGame = [&] {
+        if (isBroken) {
+            skipped++;
+        } else if (hasMoves || startFen != STARTPOS) {
+            openings.push_back(board.getFen());
+        }
+        startGame(STARTPOS);
+    };
+
+    startGame(STARTPOS);
+
+    std::size_t i = 0;
+    while (i < pgn.size()) {
+        const char c = pgn[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (c == '[') {
+            // A tag after the moves means the previous game had no result
+            if (hasMoves || isBroken) {
+                endGame();
+            }
+
+            const std::size_t end = pgn.find(']', i);
+            const std::string tag = pgn.substr(i + 1, end == std::string::npos ? std::string::npos : end - i - 1);
+            i = end == std::string::npos ? pgn.size() : end + 1;
+
+            std::istringstream tagStream(tag);
+            std::string name, value;
+            tagStream >> name;
+            std::getline(tagStream, value);
+            if (name == "FEN") {
+                const std::size_t first = value.find('"');
+                const std::size_t last = value.rfind('"');
+                if (first != std::string::npos && last > first) {
+                    const std::string fen = value.substr(first + 1, last - first - 1);
+                    if (isValidPlacement(fen.substr(0, fen.find(' ')))) {
+                        startGame(fen);
+                        isBroken = !isLegalPosition(board);
+                    } else {
+                        isBroken = true;
+                    }
+                }
+            }
+        } else if (c == '{') {
+            const std::size_t end = pgn.find('}', i);
+            i = end == std::string::npos ? pgn.size() : end + 1;
+        } else if (c == ';') {
+            const std::size_t end = pgn.find('\n', i);
+            i = end == std::string::npos ? pgn.size() : end + 1;
+        } else if (c == '(') {
+            // Variations can be nested, only the main line is played
+            int depth = 0;
+            for (; i < pgn.size(); i++) {
+                if (pgn[i] == '(') {
+                    depth++;
+                } else if (pgn[i] == ')' && --depth == 0) {
+                    i++;
+                    break;
+                } else if (pgn[i] == '{') {
+                    const std::size_t end = pgn.find('}', i);
+                    i = end == std::string::npos ? pgn.size() - 1 : end;
+                }
+            }
+        } else {
+            std::size_t end = i;
+            while (end < pgn.size() && !std::isspace(static_cast<unsigned char>(pgn[end])) &&
+                   pgn[end] != '{' && pgn[end] != '(' && pgn[end] != ';') {
+                end++;
+            }
+            std::string_view token(pgn.data() + i, end - i);
+            i = end;
+
+            if (isResult(token)) {
+                endGame();
+                continue;
+            }
+
+            if (token[0] == '$' || isBroken) {
+                continue;
+            }
+
+            // Move numbers like 12. or 12... can be glued to the move
+            if (token[0] >= '0' && token[0] <= '9' && token.find('.') != std::string_view::npos) {
+                token.remove_prefix(token.rfind('.') + 1);
+            }
+            if (token.empty() || isNumber(std::string(token))) {
+                continue;
+            }
+
+            const Move move = parseSan(board, token);
+            if (move == Move::NO_MOVE) {
+                isBroken = true;
+                continue;
+            }
+
+            board.makeMove(move);
+            hasMoves = true;
+        }
+    }
+
+    // The last game may miss its result
+    if (hasMoves || isBroken) {
+        endGame();
+    }
+
+    if (skipped > 0) {
+        std::cerr << "Skipped " << skipped << " games of the opening book with an illegal move" << std::endl;
+    }
+}
+
+Move OpeningBook::parseSan(const Board &board, std::string_view san) {
+    // Checks, annotations and the en passant suffix don't help to find the move
+    while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos) {
+        san.remove_suffix(1);
+    }
+    if (san.size() > 4 && san.substr(san.size() - 4) == "e.p.") {
+        san.remove_suffix(4);
+    }
+    if (san.size() < 2) {
+        return Move::NO_MOVE;
+    }
+
+    Movelist moveList;
+    movegen::legalmoves(moveList, board);
+
+    // Castling moves are encoded as the king capturing its own rook
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const bool kingSide = san.size() == 3;
+        for (const Move &move: moveList) {
+            if (move.typeOf() == Move::CASTLING && (move.to().file() > move.from().file()) == kingSide) {
+                return move;
+            }
+        }
+        return Move::NO_MOVE;
+    }
+
+    PieceType pieceType = getPieceType(san[0]);
+    if (pieceType != PieceType::NONE) {
+        san.remove_prefix(1);
+    } else {
+        pieceType = PieceType::PAWN;
+    }
+
+    // The promotion is written as e8=Q and sometimes as e8Q
+    PieceType promotionType = PieceType::NONE;
+    if (san.size() >= 2 && getPieceType(san.back()) != PieceType::NONE) {
+        promotionType = getPieceType(san.back());
+        san.remove_suffix(san[san.size() - 2] == '=' ? 2 : 1);
+    }
+
+    if (san.size() < 2) {
+        return Move::NO_MOVE;
+    }
+
+    const std::string_view target = san.substr(san.size() - 2);
+    if (target[0] < 'a' || target[0] > 'h' || target[1] < '1' || target[1] > '8') {
+        return Move::NO_MOVE;
+    }
+    const Square to(target);
+
+    // Whatever is left in front of the target square disambiguates the move
+    int fromFile = -1;
+    int fromRank = -1;
+    for (const char c: san.substr(0, san.size() - 2)) {
+        if (c >= 'a' && c <= 'h') {
+            fromFile = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            fromRank = c - '1';
+        } else if (c != 'x' && c != ':' && c != '-') {
+            return Move::NO_MOVE;
+        }
+    }
+
+    Move found = Move::NO_MOVE;
+    for (const Move &move: moveList) {
+        if (move.typeOf() == Move::CASTLING || move.to() != to ||
+            board.at(move.from()).type() != pieceType) {
+            continue;
+        }
+        if (fromFile != -1 && static_cast<int>(move.from().file()) != fromFile) {
+            continue;
+        }
+        if (fromRank != -1 && static_cast<int>(move.from().rank()) != fromRank) {
+            continue;
+        }
+        if ((move.typeOf() == Move::PROMOTION) != (promotionType != PieceType::NONE) ||
+            (promotionType != PieceType::NONE && move.promotionType() != promotionType)) {
+            continue;
+        }
+
+        // An ambiguous move can't be resolved
+        if (found != Move::NO_MOVE) {
+            return Move::NO_MOVE;
+        }
+        found = move;
+    }
+
+    return found;
+}
@@ -0,0 +1,63 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chess.hpp"
+
+using namespace chess;
+
+// A list of opening positions, read from an EPD or a PGN file
+class OpeningBook {
+public:
+    // Files ending in .pgn are read as PGN, where every game is played out to its last move.
+    // Every other file is read as EPD with one position per line
+    bool load(const std::string &path);
+
+    [[nodiscard]] std::size_t size() const {
+        return openings.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return openings.empty();
+    }
+
+    [[nodiscard]] const std::string &getOpening(const std::size_t index) const {
+        return openings[index];
+    }
+
+    // Converts a move in standard algebraic notation like Nbd7 or exd8=Q+.
+    // Returns Move::NO_MOVE if the move isn't legal in the position
+    static Move parseSan(const Board &board, std::string_view san);
+
+private:
+    std::vector<std::string> openings;
+
+    void loadEpd(std::istream &stream);
+
+    void loadPgn(std::istream &stream);
+};
+
+#endif
@@ -53,6 +53,7 @@ VERSION: 0.6.76
 #include <ostream>
 
 #include "NNUE/nnue.h"
+#include "profiler.h"
 
 namespace chess {
     class Color {
@@ -3260,6 +3261,7 @@ namespace chess {
 
     template<movegen::MoveGenType mt>
     inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
+        PROFILE_SCOPE(MOVEGEN);
         movelist.clear();
 
         if (board.sideToMove() == Color::WHITE)
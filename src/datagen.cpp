@@ -18,24 +18,649 @@
 */
 
 #include "datagen.h"
+#include "allocations.h"
+#include "book.h"
 #include "consts.h"
 #include "helper.h"
 #include "see.h"
 #include "timeman.h"
 #include "NNUE/nnue.h"
+#include "syzygy/tbprobe.h"
+#include <cmath>
+#include <limits>
 #include <random>
 #include <string>
 #include <vector>
-#include <mutex>
 #include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
 #include <cassert>
 
-// Global resources shared across all threads
-extern std::mutex outputFileMutex;
-extern std::atomic<std::uint64_t> totalPositionsGenerated;
+// The amount of positions written by all threads together
+std::atomic<std::uint64_t> totalPositionsGenerated(0);
 
-void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmount) {
-    tt transpositionTable(16);
+namespace {
+    // A small table is enough for the few thousand nodes per move, and it is cheap to clear after every game
+    constexpr std::uint64_t datagenHashSize = 8;
+
+    std::atomic<std::uint64_t> totalGamesPlayed(0);
+    std::atomic<std::uint64_t> totalGameAllocations(0);
+
+    // The amount of written games for every GameEndReason
+    std::atomic<std::uint64_t> gameEndCounts[4];
+
+    // The amount of games discarded because the opening was too unbalanced
+    std::atomic<std::uint64_t> filteredOpenings(0);
+
+    // Shared by all threads, it is only read after runDatagen loaded it
+    OpeningBook openingBook;
+
+    // The allocations per game for the progress line, empty if they aren't counted
+    std::string getAllocationsPerGame() {
+#ifdef COUNT_ALLOCATIONS
+        const std::uint64_t games = totalGamesPlayed.load();
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(2) << "Allocs/game: "
+                << (games > 0 ? static_cast<double>(totalGameAllocations.load()) / games : 0.0) << " | ";
+        return stream.str();
+#else
+        return "";
+#endif
+    }
+
+    std::uint64_t splitMix64(std::uint64_t &state) {
+        std::uint64_t z = state += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Mixes a stream number into a seed, so neighbouring threads and games get unrelated seeds
+    std::uint64_t deriveSeed(const std::uint64_t seed, const std::uint64_t stream) {
+        std::uint64_t streamState = stream;
+        std::uint64_t state = seed ^ splitMix64(streamState);
+        return splitMix64(state);
+    }
+
+    // A small and fast generator for the random opening moves
+    class Prng {
+    public:
+        explicit Prng(const std::uint64_t seed) : state(seed) {
+        }
+
+        std::uint64_t next() {
+            return splitMix64(state);
+        }
+
+        // A number in [0, bound) without a division
+        std::uint32_t nextBelow(const std::uint32_t bound) {
+            return static_cast<std::uint32_t>((next() >> 32) * bound >> 32);
+        }
+
+    private:
+        std::uint64_t state;
+    };
+
+    // The position filters in the order in which they are applied
+    enum class PositionFilter {
+        OPENING_PLIES,
+        IN_CHECK,
+        CAPTURE,
+        PROMOTION,
+        SCORE,
+        QSEARCH,
+        GAME_CAP,
+        NONE
+    };
+
+    constexpr int positionFilterCount = static_cast<int>(PositionFilter::NONE);
+
+    constexpr const char *positionFilterNames[positionFilterCount] = {
+        "opening plies", "in check", "capture", "promotion", "score", "qsearch", "game cap"
+    };
+
+    // The amount of positions every filter removed from the written games
+    std::atomic<std::uint64_t> filteredPositions[positionFilterCount];
+
+    // Returns the first filter that rejects the position. The score is from the point of view of white
+    PositionFilter getPositionFilter(const DatagenConfig &config, Search &search, Board &board, const Move bestMove,
+                                     const int ply, const int score) {
+        if (ply < config.skipPlies) {
+            return PositionFilter::OPENING_PLIES;
+        }
+        if (config.skipChecks && board.inCheck()) {
+            return PositionFilter::IN_CHECK;
+        }
+        if (config.skipCaptures && board.isCapture(bestMove)) {
+            return PositionFilter::CAPTURE;
+        }
+        if (config.skipPromotions && bestMove.typeOf() == Move::PROMOTION) {
+            return PositionFilter::PROMOTION;
+        }
+        if (std::abs(score) >= config.maxScore) {
+            return PositionFilter::SCORE;
+        }
+
+        // A position that isn't quiet gets a score the static eval can't know about.
+        // The qsearch is the most expensive filter, so it runs last
+        if (config.qsearchMargin > 0 && !board.inCheck()) {
+            search.nodeLimit = Search::NO_NODE_LIMIT;
+            const int qsearchScore = search.qs(-EVAL_INFINITE, EVAL_INFINITE, board, 0);
+            if (std::abs(qsearchScore - search.evaluate(board)) > config.qsearchMargin) {
+                return PositionFilter::QSEARCH;
+            }
+        }
+
+        return PositionFilter::NONE;
+    }
+
+    // Keeps count randomly picked entries, a partial Fisher-Yates shuffle moves them to the front
+    template<typename T>
+    void keepRandomEntries(std::vector<T> &entries, const std::size_t count, Prng &prng) {
+        for (std::size_t i = 0; i < count; i++) {
+            const std::size_t pick = i + prng.nextBelow(static_cast<std::uint32_t>(entries.size() - i));
+            std::swap(entries[i], entries[pick]);
+        }
+        entries.resize(count);
+    }
+
+    std::string getCheckpointPath(const std::string &shardPath) {
+        return shardPath + ".ckpt";
+    }
+
+    // One line per written game: index, seed, positions, result and GameEndReason
+    std::string getGameLogPath(const std::string &shardPath) {
+        return shardPath + ".games";
+    }
+
+    bool readCheckpoint(const std::string &path, DatagenCheckpoint &checkpoint) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::string key;
+        while (file >> key) {
+            if (key == "seed") {
+                file >> checkpoint.seed;
+            } else if (key == "games") {
+                file >> checkpoint.games;
+            } else if (key == "positions") {
+                file >> checkpoint.positions;
+            } else if (key == "bytes") {
+                file >> checkpoint.bytes;
+            } else if (key == "logbytes") {
+                file >> checkpoint.logBytes;
+            } else if (key == "nextgame") {
+                file >> checkpoint.nextGame;
+                checkpoint.isValid = true;
+            }
+        }
+        return checkpoint.isValid;
+    }
+
+    // The checkpoint is written to a temporary file first, so a kill never leaves a half written checkpoint
+    void writeCheckpoint(const std::string &path, const DatagenCheckpoint &checkpoint) {
+        const std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::trunc);
+            file << "seed " << checkpoint.seed << "\n"
+                    << "games " << checkpoint.games << "\n"
+                    << "positions " << checkpoint.positions << "\n"
+                    << "bytes " << checkpoint.bytes << "\n"
+                    << "logbytes " << checkpoint.logBytes << "\n"
+                    << "nextgame " << checkpoint.nextGame << "\n";
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+
+    // Accepts unsigned integers, parsed exactly so even 64 bit seeds keep every bit
+    bool parseInteger(const std::string &value, std::uint64_t &number) {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        try {
+            std::size_t length;
+            number = std::stoull(value, &length);
+            return length == value.size();
+        } catch ([[maybe_unused]] const std::exception &e) {
+            return false;
+        }
+    }
+
+    // Accepts integers and the shorthand 1e9, which is only meant for large counts like positions
+    bool parseAmount(const std::string &value, std::uint64_t &amount) {
+        if (parseInteger(value, amount)) {
+            return true;
+        }
+        try {
+            std::size_t length;
+            const double parsed = std::stod(value, &length);
+
+            // 2^64 is the first value that doesn't fit into 64 bits anymore
+            if (length != value.size() || !(parsed >= 0) || parsed >= 18446744073709551616.0 ||
+                parsed != std::floor(parsed)) {
+                return false;
+            }
+            amount = static_cast<std::uint64_t>(parsed);
+            return true;
+        } catch ([[maybe_unused]] const std::exception &e) {
+            return false;
+        }
+    }
+}
+
+PackedBoard PackedBoard::pack(const Board &board, const int score) {
+    PackedBoard packed{};
+    packed.occupancy = board.occ().getBits();
+
+    // Rooks that can still castle are stored as a seventh piece type
+    Bitboard castlingRooks = 0;
+    for (const Color color: {Color::WHITE, Color::BLACK}) {
+        for (const auto side: {Board::CastlingRights::Side::KING_SIDE, Board::CastlingRights::Side::QUEEN_SIDE}) {
+            if (board.castlingRights().has(color, side)) {
+                const Rank rank = color == Color::WHITE ? Rank::RANK_1 : Rank::RANK_8;
+                castlingRooks |= Bitboard::fromSquare(Square(board.castlingRights().getRookFile(color, side), rank));
+            }
+        }
+    }
+
+    Bitboard occupancy = board.occ();
+    for (int i = 0; occupancy; i++) {
+        const Square square = occupancy.pop();
+        const Piece piece = board.at(square);
+
+        std::uint8_t nibble = castlingRooks.check(square.index()) ? 6 : static_cast<int>(piece.type());
+        nibble |= static_cast<std::uint8_t>(piece.color() == Color::BLACK) << 3;
+
+        packed.pieces[i / 2] |= nibble << (4 * (i % 2));
+    }
+
+    packed.stmEpSquare = static_cast<std::uint8_t>(board.sideToMove() == Color::BLACK) << 7 |
+                         static_cast<std::uint8_t>(board.enpassantSq().index());
+    packed.halfMoveClock = static_cast<std::uint8_t>(board.halfMoveClock());
+    packed.fullMoveNumber = static_cast<std::uint16_t>(board.fullMoveNumber());
+    packed.score = static_cast<std::int16_t>(score);
+    packed.wdl = 1;
+    return packed;
+}
+
+std::string getShardPath(const std::string &out, const int threadId, const DatagenFormat format) {
+    return out + "_" + std::to_string(threadId) + (format == DatagenFormat::PACKED ? ".bin" : ".txt");
+}
+
+std::uint64_t getGameSeed(const std::uint64_t masterSeed, const int threadId, const std::uint64_t gameIndex) {
+    return deriveSeed(deriveSeed(masterSeed, threadId), gameIndex);
+}
+
+void getChess960Fen(std::string &fen, const int whiteIndex, const int blackIndex) {
+    // The knights go on two of the five squares that are left after placing the bishops and the queen
+    constexpr int knightSquares[10][2] = {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2}, {1, 3}, {1, 4}, {2, 3}, {2, 4}, {3, 4}};
+
+    auto getBackRank = [&](int index, char *rank) {
+        std::fill(rank, rank + 8, ' ');
+
+        // Puts the piece on the n-th empty square
+        auto placeOnEmpty = [&](int n, const char piece) {
+            for (int file = 0; file < 8; file++) {
+                if (rank[file] == ' ' && n-- == 0) {
+                    rank[file] = piece;
+                    return;
+                }
+            }
+        };
+
+        rank[2 * (index % 4) + 1] = 'B';
+        index /= 4;
+        rank[2 * (index % 4)] = 'B';
+        index /= 4;
+        placeOnEmpty(index % 6, 'Q');
+        index /= 6;
+
+        // The second knight is placed after the first one took its square
+        placeOnEmpty(knightSquares[index][1], 'N');
+        placeOnEmpty(knightSquares[index][0], 'N');
+
+        // The king is always between the two rooks
+        placeOnEmpty(0, 'R');
+        placeOnEmpty(0, 'K');
+        placeOnEmpty(0, 'R');
+    };
+
+    char whiteRank[8];
+    char blackRank[8];
+    getBackRank(whiteIndex, whiteRank);
+    getBackRank(blackIndex, blackRank);
+
+    // Assigning into the existing capacity keeps datagen free of allocations
+    fen.clear();
+    for (const char piece: blackRank) {
+        fen.push_back(static_cast<char>(piece - 'A' + 'a'));
+    }
+    fen.append("/pppppppp/8/8/8/8/PPPPPPPP/");
+    fen.append(whiteRank, 8);
+    fen.append(" w KQkq - 0 1");
+}
+
+bool parseDatagenConfig(std::istream &args, DatagenConfig &config) {
+    std::string token;
+    while (args >> token) {
+        const std::size_t separator = token.find('=');
+        if (separator == std::string::npos) {
+            std::cerr << "Expected key=value but got '" << token << "'" << std::endl;
+            return false;
+        }
+
+        const std::string key = token.substr(0, separator);
+        const std::string value = token.substr(separator + 1);
+        std::uint64_t amount = 0;
+
+        if (key == "config") {
+            // Every line of the config file holds key=value pairs, everything after a # is ignored
+            std::ifstream file(value);
+            if (!file.is_open()) {
+                std::cerr << "Could not open the config file " << value << std::endl;
+                return false;
+            }
+
+            std::string line;
+            std::string contents;
+            while (std::getline(file, line)) {
+                contents += line.substr(0, line.find('#')) + "\n";
+            }
+
+            std::istringstream configArgs(contents);
+            if (!parseDatagenConfig(configArgs, config)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (key == "out") {
+            config.out = value;
+            continue;
+        }
+
+        if (key == "syzygy") {
+            config.syzygyPath = value;
+            continue;
+        }
+
+        if (key == "book") {
+            config.bookPath = value;
+            continue;
+        }
+
+        if (key == "format") {
+            if (value != "text" && value != "packed") {
+                std::cerr << "Unknown format '" << value << "', use text or packed" << std::endl;
+                return false;
+            }
+            config.format = value == "packed" ? DatagenFormat::PACKED : DatagenFormat::TEXT;
+            continue;
+        }
+
+        if (key == "variant") {
+            if (value == "standard") {
+                config.variant = DatagenVariant::STANDARD;
+            } else if (value == "frc") {
+                config.variant = DatagenVariant::FRC;
+            } else if (value == "dfrc") {
+                config.variant = DatagenVariant::DFRC;
+            } else {
+                std::cerr << "Invalid value for " << key << ": '" << value << "', use standard, frc or dfrc" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        // Only the amount of positions accepts the 1e9 shorthand, everything else has to fit into an int
+        const bool isValid = key == "positions"
+                                 ? parseAmount(value, amount)
+                                 : parseInteger(value, amount) &&
+                                   (key == "seed" || key == "nodes" || key == "evalnodes" ||
+                                    amount <= static_cast<std::uint64_t>(std::numeric_limits<int>::max()));
+        if (!isValid) {
+            std::cerr << "Invalid value for " << key << ": '" << value << "'" << std::endl;
+            return false;
+        }
+
+        if (key == "threads") {
+            config.threads = std::max(1, static_cast<int>(amount));
+        } else if (key == "positions") {
+            config.positions = amount;
+        } else if (key == "nodes") {
+            config.nodes = std::max<std::uint64_t>(1, amount);
+        } else if (key == "randomplies") {
+            config.randomPlies = static_cast<int>(amount);
+        } else if (key == "maxplies") {
+            config.maxPlies = static_cast<int>(amount);
+        } else if (key == "seed") {
+            config.seed = amount;
+        } else if (key == "winscore") {
+            config.winScore = static_cast<int>(amount);
+        } else if (key == "winplies") {
+            config.winPlies = static_cast<int>(amount);
+        } else if (key == "drawscore") {
+            config.drawScore = static_cast<int>(amount);
+        } else if (key == "drawplies") {
+            config.drawPlies = static_cast<int>(amount);
+        } else if (key == "drawafter") {
+            config.drawAfter = static_cast<int>(amount);
+        } else if (key == "tbadj") {
+            config.tablebaseAdjudication = amount != 0;
+        } else if (key == "skipplies") {
+            config.skipPlies = static_cast<int>(amount);
+        } else if (key == "skipchecks") {
+            config.skipChecks = amount != 0;
+        } else if (key == "skipcaptures") {
+            config.skipCaptures = amount != 0;
+        } else if (key == "skippromotions") {
+            config.skipPromotions = amount != 0;
+        } else if (key == "maxscore") {
+            config.maxScore = static_cast<int>(amount);
+        } else if (key == "qsmargin") {
+            config.qsearchMargin = static_cast<int>(amount);
+        } else if (key == "maxgamepositions") {
+            config.maxGamePositions = static_cast<int>(amount);
+        } else if (key == "evalwindow") {
+            config.evalWindow = static_cast<int>(amount);
+        } else if (key == "evalnodes") {
+            config.evalNodes = std::max<std::uint64_t>(1, amount);
+        } else {
+            std::cerr << "Unknown datagen option '" << key << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+DatagenConfig askDatagenConfig() {
+    DatagenConfig config;
+
+    std::cout << "Enter the number of threads to use (press Enter to use half of the available threads): ";
+    std::string threadInput;
+    std::getline(std::cin, threadInput);
+
+    if (threadInput.empty()) {
+        config.threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    } else {
+        try {
+            config.threads = std::stoi(threadInput);
+        } catch ([[maybe_unused]] const std::invalid_argument &ia) {
+            std::cerr << "Invalid number of threads. Using half of the available threads." << std::endl;
+            config.threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+        }
+    }
+
+    std::cout << "Enter the number of positions to generate: ";
+    std::cin >> config.positions;
+    // Consume the rest of the line
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    std::cout << "Enter the output format, text or packed (press Enter to use text): ";
+    std::string formatInput;
+    std::getline(std::cin, formatInput);
+    config.format = formatInput == "packed" ? DatagenFormat::PACKED : DatagenFormat::TEXT;
+
+    return config;
+}
+
+bool runDatagen(const DatagenConfig &config) {
+    if (!config.syzygyPath.empty()) {
+        Tablebase::init(config.syzygyPath);
+    }
+
+    if (!config.bookPath.empty() && !openingBook.load(config.bookPath)) {
+        return false;
+    }
+
+    // Shards with a checkpoint continue where they stopped
+    std::vector<DatagenCheckpoint> checkpoints(config.threads);
+    std::uint64_t resumedPositions = 0;
+    std::uint64_t resumedSeed = 0;
+
+    // A shard is only continued if it can be reproduced. That needs its checkpoint and the seed the shard was
+    // started with, appending to anything else would mix games that can't be replayed into the shard
+    for (int i = 0; i < config.threads; i++) {
+        const std::string shardPath = getShardPath(config.out, i, config.format);
+        if (!readCheckpoint(getCheckpointPath(shardPath), checkpoints[i])) {
+            if (std::filesystem::exists(shardPath) || std::filesystem::exists(getGameLogPath(shardPath))) {
+                std::cerr << shardPath << " already exists without a checkpoint, remove it or choose another out"
+                        << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        const std::uint64_t seed = checkpoints[i].seed;
+        if ((config.seed != 0 && seed != config.seed) || (resumedSeed != 0 && seed != resumedSeed)) {
+            std::cerr << shardPath << " was started with seed " << seed
+                    << ", resume it without seed= or with the same seed" << std::endl;
+            return false;
+        }
+
+        resumedPositions += checkpoints[i].positions;
+        resumedSeed = seed;
+    }
+
+    totalPositionsGenerated = resumedPositions;
+
+    // Without a given seed a resumed run keeps its seed, and a new run picks a random one
+    DatagenConfig runConfig = config;
+    if (runConfig.seed == 0) {
+        runConfig.seed = resumedSeed != 0 ? resumedSeed : (static_cast<std::uint64_t>(std::random_device()()) << 32 |
+                                                           std::random_device()());
+    }
+
+    std::cout << "Starting datagen with " << config.threads << " threads and seed " << runConfig.seed << "."
+            << std::endl;
+    if (resumedPositions > 0) {
+        std::cout << "Resuming with " << resumedPositions << " positions from the checkpoints." << std::endl;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.threads; ++i) {
+        // Launch each thread to run the 'generate' function on its own shard
+        threads.emplace_back(generate, i, std::cref(runConfig), checkpoints[i]);
+    }
+
+    const std::uint64_t positionAmount = config.positions;
+
+    // Periodically print statistics from the main thread
+    auto startTime = std::chrono::steady_clock::now();
+    while (totalPositionsGenerated < positionAmount) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+        if (elapsedTime > 0) {
+            // Use .load() for safe reading of atomic variable
+            auto currentPositions = totalPositionsGenerated.load();
+            double pps = static_cast<double>(currentPositions - resumedPositions) / elapsedTime;
+
+            // Ensure ETA is never negative
+            double eta = (pps > 0 && currentPositions < positionAmount)
+                             ? (positionAmount - currentPositions) / pps
+                             : 0.0;
+
+            // Cap displayed progress at 100%
+            double progress = std::min(100.0, static_cast<double>(currentPositions) / positionAmount * 100.0);
+
+            std::cout << "\r" << std::fixed << std::setprecision(2)
+                    << "Progress: " << progress << "% | "
+                    << "Positions: " << currentPositions << "/" << positionAmount << " | "
+                    << "PPS: " << static_cast<int>(pps) << " | "
+                    << getAllocationsPerGame()
+                    << "Adj W/D/TB: " << gameEndCounts[1] << "/" << gameEndCounts[2] << "/" << gameEndCounts[3]
+                    << " | "
+                    << "ETA: " << static_cast<int>(eta) << "s   " << std::flush;
+        }
+    }
+
+    // Print the progress bar
+    std::cout << "\r" << std::fixed << std::setprecision(2)
+            << "Progress: " << 100.00 << "% | "
+            << "Positions: " << positionAmount << "/" << positionAmount << " | "
+            << "PPS: " << 0 << " | "
+            << getAllocationsPerGame()
+            << "Adj W/D/TB: " << gameEndCounts[1] << "/" << gameEndCounts[2] << "/" << gameEndCounts[3] << " | "
+            << "ETA: " << 0 << "s   " << std::endl;
+
+    for (std::thread &t: threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    std::cout << "Filtered positions:";
+    for (int i = 0; i < positionFilterCount; i++) {
+        std::cout << " " << positionFilterNames[i] << " " << filteredPositions[i] << (
+            i + 1 < positionFilterCount ? "," : "");
+    }
+    std::cout << std::endl;
+
+    if (config.evalWindow > 0) {
+        std::cout << "Discarded " << filteredOpenings << " openings outside of the eval window." << std::endl;
+    }
+
+    std::cout << "The positions were written to " << getShardPath(config.out, 0, config.format) << " up to "
+            << getShardPath(config.out, config.threads - 1, config.format) << ", use merge to combine them."
+            << std::endl;
+    return true;
+}
+
+void generate(int threadId, const DatagenConfig &config, DatagenCheckpoint checkpoint) {
+    const DatagenFormat format = config.format;
+    const std::uint64_t positionAmount = config.positions;
+    const std::string shardPath = getShardPath(config.out, threadId, format);
+    const std::string checkpointPath = getCheckpointPath(shardPath);
+
+    const std::string gameLogPath = getGameLogPath(shardPath);
+
+    // runDatagen refuses shards without a checkpoint, so without one the shard is new
+    if (checkpoint.isValid) {
+        // Everything after the checkpoint belongs to games we are going to play again
+        std::error_code error;
+        std::filesystem::resize_file(shardPath, checkpoint.bytes, error);
+        std::filesystem::resize_file(gameLogPath, checkpoint.logBytes, error);
+    }
+    checkpoint.seed = config.seed;
+
+    std::ofstream outputFile(shardPath, std::ios::app | std::ios::binary);
+    std::ofstream gameLogFile(gameLogPath, std::ios::app | std::ios::binary);
+    if (!outputFile.is_open() || !gameLogFile.is_open()) {
+        std::cerr << "Error opening " << shardPath << " for datagen!" << std::endl;
+        return;
+    }
+
+    tt transpositionTable(datagenHashSize);
     TimeManagement timeManagement;
     Network net;
     const auto search =
@@ -45,28 +670,86 @@ void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmo
     Board board(&net);
     search->initLMR();
 
-    std::random_device rd;
-    std::mt19937 gen(rd() + threadId);
+    // Chess960 castling rights and moves are also used for the opening book in the Chess960 modes
+    board.set960(config.variant != DatagenVariant::STANDARD);
+    std::string startFen;
+    startFen.reserve(128);
 
-    // The persistent buffer for batching writes.
-    std::vector<std::string> writeBuffer;
+    // The persistent buffer for batching writes. Both formats are appended as raw bytes
+    std::string writeBuffer;
+    std::uint64_t bufferedPositions = 0;
+    std::uint64_t bufferedGames = 0;
+
+    // The index of the next game, a resumed shard continues after the checkpointed games
+    std::uint64_t gameIndex = checkpoint.nextGame;
 
     // Pre-allocate memory
-    writeBuffer.reserve(5120);
+    writeBuffer.reserve(5120 * (format == DatagenFormat::PACKED ? sizeof(PackedBoard) : 96));
+
+    std::string gameLogBuffer;
+    gameLogBuffer.reserve(4096);
+
+    // Writes the buffers and then the checkpoint, so the checkpoint never covers unwritten games
+    auto flush = [&] {
+        outputFile.write(writeBuffer.data(), static_cast<std::streamsize>(writeBuffer.size()));
+        outputFile.flush();
+        gameLogFile.write(gameLogBuffer.data(), static_cast<std::streamsize>(gameLogBuffer.size()));
+        gameLogFile.flush();
+
+        checkpoint.games += bufferedGames;
+        checkpoint.positions += bufferedPositions;
+        checkpoint.bytes += writeBuffer.size();
+        checkpoint.logBytes += gameLogBuffer.size();
+        checkpoint.nextGame = gameIndex;
+        writeCheckpoint(checkpointPath, checkpoint);
+
+        // Clear the buffer for the next batch
+        writeBuffer.clear();
+        gameLogBuffer.clear();
+        bufferedPositions = 0;
+        bufferedGames = 0;
+    };
+
+    // How many positions of the current game every filter removed
+    std::uint64_t filterCounts[positionFilterCount] = {};
+
+    // Temporary storage for the current game, it keeps its capacity between the games
+    std::vector<std::pair<std::string, int> > currentGameData;
+    std::vector<PackedBoard> packedGameData;
+    currentGameData.reserve(config.maxPlies);
+    packedGameData.reserve(config.maxPlies);
 
     while (totalPositionsGenerated < positionAmount) {
-        board.setFen(STARTPOS);
+        const std::uint64_t allocationsBefore = getThreadAllocations();
+
+        // Every game starts with a fresh search state
+        transpositionTable.clear();
+        search->resetHistory();
+
+        const std::uint64_t gameSeed = getGameSeed(config.seed, threadId, gameIndex);
+        const std::uint64_t currentGameIndex = gameIndex++;
+        Prng prng(gameSeed);
+
+        if (!openingBook.empty()) {
+            board.setFen(openingBook.getOpening(prng.nextBelow(openingBook.size())));
+        } else if (config.variant != DatagenVariant::STANDARD) {
+            const int whiteIndex = static_cast<int>(prng.nextBelow(960));
+            getChess960Fen(startFen, whiteIndex,
+                           config.variant == DatagenVariant::DFRC ? static_cast<int>(prng.nextBelow(960)) : whiteIndex);
+            board.setFen(startFen);
+        } else {
+            board.setFen(STARTPOS);
+        }
         bool exitEarly = false;
 
-        for (int i = 0; i < 10; i++) {
+        for (int i = 0; i < config.randomPlies; i++) {
             Movelist moveList;
             movegen::legalmoves(moveList, board);
             if (auto [fst, snd] = board.isGameOver(); snd != GameResult::NONE || moveList.empty()) {
                 exitEarly = true;
                 break;
             }
-            std::uniform_int_distribution dis(0, moveList.size() - 1);
-            Move move = moveList[dis(gen)];
+            Move move = moveList[prng.nextBelow(moveList.size())];
             board.makeMove(move);
         }
 
@@ -74,72 +757,278 @@ void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmo
             continue;
         }
 
-        // Temporary storage for the current game
-        std::vector<std::pair<std::string, int> > currentGameData;
+        // Skip openings that are already decided, they only teach the net to convert won positions.
+        // currentScore still holds the score of the last game if not even the first iteration finished
+        if (config.evalWindow > 0) {
+            search->nodeLimit = config.evalNodes;
+            search->iterativeDeepening(board, params);
+            if (search->completedDepth > 0 && std::abs(search->currentScore) > config.evalWindow) {
+                filteredOpenings++;
+                continue;
+            }
+            transpositionTable.clear();
+            search->resetHistory();
+        }
+
+        currentGameData.clear();
+        packedGameData.clear();
+        std::fill(std::begin(filterCounts), std::end(filterCounts), 0);
         std::string resultString = "none";
+        GameEndReason endReason = GameEndReason::NATURAL;
+
+        // How many plies in a row the score was decisive or drawish
+        int winPlies = 0;
+        int lossPlies = 0;
+        int drawPlies = 0;
 
         // Play out the game
-        for (int i = 0; i < 500; i++) {
+        for (int i = 0; i < config.maxPlies; i++) {
             if (auto [fst, snd] = board.isGameOver(); snd != GameResult::NONE) {
                 if (snd == GameResult::DRAW) resultString = "0.5";
                 else resultString = snd == GameResult::LOSE && board.sideToMove() == Color::BLACK ? "1.0" : "0.0";
                 break;
             }
 
-            search->nodeLimit = 5000;
+            // Tablebase adjudication. Like in the search the WDL tables are only probed with a zeroed halfmove
+            // clock, otherwise they can't tell a win from a cursed win. The game then goes on until the next
+            // capture or pawn move
+            if (config.tablebaseAdjudication && Tablebase::maxCardinality > 0 &&
+                board.occ().count() <= Tablebase::maxCardinality && board.halfMoveClock() == 0 &&
+                board.castlingRights().isEmpty()) {
+                ProbeState result;
+                if (const WDLScore wdl = Tablebase::probeWDL(board, &result); result != ProbeState::FAIL) {
+                    // Cursed wins and blessed losses are draws under the 50-move rule
+                    const bool whiteToMove = board.sideToMove() == Color::WHITE;
+                    resultString = wdl == WDL_WIN
+                                       ? whiteToMove ? "1.0" : "0.0"
+                                       : wdl == WDL_LOSS
+                                             ? whiteToMove ? "0.0" : "1.0"
+                                             : "0.5";
+                    endReason = GameEndReason::TABLEBASE_ADJUDICATION;
+                    break;
+                }
+            }
+
+            search->nodeLimit = config.nodes;
             search->iterativeDeepening(board, params);
             Move bestMove = search->rootBestMove;
 
-            if (bestMove.typeOf() == Move::PROMOTION || board.inCheck() || board.isCapture(bestMove) || std::abs(
-                    search->currentScore) >= 10000) {
+            int score = board.sideToMove() == Color::WHITE ? search->currentScore : -search->currentScore;
+
+            // Win adjudication
+            winPlies = score >= config.winScore ? winPlies + 1 : 0;
+            lossPlies = score <= -config.winScore ? lossPlies + 1 : 0;
+
+            if (config.winPlies > 0 && (winPlies >= config.winPlies || lossPlies >= config.winPlies)) {
+                resultString = winPlies >= config.winPlies ? "1.0" : "0.0";
+                endReason = GameEndReason::WIN_ADJUDICATION;
+                break;
+            }
+
+            // Draw adjudication
+            drawPlies = i >= config.drawAfter && std::abs(score) <= config.drawScore ? drawPlies + 1 : 0;
+
+            if (config.drawPlies > 0 && drawPlies >= config.drawPlies) {
+                resultString = "0.5";
+                endReason = GameEndReason::DRAW_ADJUDICATION;
+                break;
+            }
+
+            if (const PositionFilter filter = getPositionFilter(config, *search, board, bestMove, i, score);
+                filter != PositionFilter::NONE) {
+                filterCounts[static_cast<int>(filter)]++;
                 board.makeMove(bestMove);
                 continue;
             }
 
-            int score = board.sideToMove() == Color::WHITE ? search->currentScore : -search->currentScore;
-
-            // Store FEN and score in the temporary container
-            currentGameData.emplace_back(board.getFen(), score);
+            // Store the position and score in the temporary container
+            if (format == DatagenFormat::PACKED) {
+                packedGameData.push_back(PackedBoard::pack(board, score));
+            } else {
+                currentGameData.emplace_back(board.getFen(), score);
+            }
 
             board.makeMove(bestMove);
         }
 
+        // Writing the buffer doesn't belong to the game, so we count the allocations here
+        totalGamesPlayed++;
+        totalGameAllocations += getThreadAllocations() - allocationsBefore;
+
         // Discard incomplete games
         if (resultString == "none") {
             continue;
         }
 
-        // Append the result
-        for (const auto &[fst, snd]: currentGameData) {
-            std::string line = fst;
-            line.append(" | ");
-            line.append(std::to_string(snd));
-            line.append(" | ");
-            line.append(resultString);
-            writeBuffer.push_back(line);
+        // Only a random part of long games is kept, so they don't dominate the data
+        const std::size_t gameSize = format == DatagenFormat::PACKED ? packedGameData.size() : currentGameData.size();
+        if (config.maxGamePositions > 0 && gameSize > static_cast<std::size_t>(config.maxGamePositions)) {
+            if (format == DatagenFormat::PACKED) {
+                keepRandomEntries(packedGameData, config.maxGamePositions, prng);
+            } else {
+                keepRandomEntries(currentGameData, config.maxGamePositions, prng);
+            }
+            filterCounts[static_cast<int>(PositionFilter::GAME_CAP)] += gameSize - config.maxGamePositions;
         }
-        totalPositionsGenerated += currentGameData.size();
 
-        // Check if the persistent buffer is full enough to write
-        if (writeBuffer.size() >= 5000) {
-            std::lock_guard guard(outputFileMutex);
-            for (const auto &line: writeBuffer) {
-                outputFile << line << "\n";
+        for (int i = 0; i < positionFilterCount; i++) {
+            filteredPositions[i] += filterCounts[i];
+        }
+
+        bufferedGames++;
+        gameEndCounts[static_cast<int>(endReason)]++;
+
+        const std::size_t gamePositions = format == DatagenFormat::PACKED
+                                              ? packedGameData.size()
+                                              : currentGameData.size();
+        gameLogBuffer.append(std::to_string(currentGameIndex) + " " + std::to_string(gameSeed) + " " +
+                             std::to_string(gamePositions) + " " + resultString + " " +
+                             std::to_string(static_cast<int>(endReason)) + "\n");
+
+        // Append the result
+        if (format == DatagenFormat::PACKED) {
+            const std::uint8_t wdl = resultString == "1.0" ? 2 : resultString == "0.5" ? 1 : 0;
+            for (PackedBoard &packed: packedGameData) {
+                packed.wdl = wdl;
+                packed.extra = static_cast<std::uint8_t>(endReason);
             }
-            outputFile.flush();
+            writeBuffer.append(reinterpret_cast<const char *>(packedGameData.data()),
+                               packedGameData.size() * sizeof(PackedBoard));
+            bufferedPositions += packedGameData.size();
+            totalPositionsGenerated += packedGameData.size();
+        } else {
+            for (const auto &[fst, snd]: currentGameData) {
+                writeBuffer.append(fst);
+                writeBuffer.append(" | ");
+                writeBuffer.append(std::to_string(snd));
+                writeBuffer.append(" | ");
+                writeBuffer.append(resultString);
+                writeBuffer.push_back('\n');
+            }
+            bufferedPositions += currentGameData.size();
+            totalPositionsGenerated += currentGameData.size();
+        }
 
-            // Clear the buffer for the next batch
-            writeBuffer.clear();
+        // Check if the persistent buffer is full enough to write
+        if (bufferedPositions >= 5000) {
+            flush();
         }
     }
 
     // After the loop, write any remaining data in the buffer.
     if (!writeBuffer.empty()) {
-        std::lock_guard guard(outputFileMutex);
-        for (const auto& line : writeBuffer) {
+        flush();
+    }
+}
+
+bool mergeShards(const std::vector<std::string> &inputPaths, const std::string &outputPath, const bool shuffle) {
+    const std::filesystem::path extension = std::filesystem::path(outputPath).extension();
+    const bool packed = extension == ".bin";
+
+    // Everything is checked before the output is truncated, a mix of formats would only give a corrupt file
+    for (const std::string &inputPath: inputPaths) {
+        if (std::filesystem::path(inputPath).extension() != extension) {
+            std::cerr << "Cannot merge " << inputPath << " into " << outputPath << ", the extensions differ"
+                    << std::endl;
+            return false;
+        }
+
+        if (inputPath == outputPath) {
+            std::cerr << "Cannot merge " << outputPath << " into itself" << std::endl;
+            return false;
+        }
+
+        std::error_code error;
+        const std::uintmax_t size = std::filesystem::file_size(inputPath, error);
+        if (error) {
+            std::cerr << "Error opening " << inputPath << std::endl;
+            return false;
+        }
+
+        if (packed && size % sizeof(PackedBoard) != 0) {
+            std::cerr << inputPath << " is not made of whole " << sizeof(PackedBoard) << " byte records" << std::endl;
+            return false;
+        }
+    }
+
+    std::ofstream outputFile(outputPath, std::ios::binary | std::ios::trunc);
+    if (!outputFile.is_open()) {
+        std::cerr << "Error opening " << outputPath << std::endl;
+        return false;
+    }
+
+    // Without shuffling we can simply stream every shard into the output
+    if (!shuffle) {
+        for (const std::string &inputPath: inputPaths) {
+            std::ifstream inputFile(inputPath, std::ios::binary);
+            if (!inputFile.is_open()) {
+                std::cerr << "Error opening " << inputPath << std::endl;
+                return false;
+            }
+            outputFile << inputFile.rdbuf();
+        }
+        return outputFile.good();
+    }
+
+    // For shuffling every entry has to be in memory
+    std::vector<PackedBoard> records;
+    std::vector<std::string> lines;
+
+    for (const std::string &inputPath: inputPaths) {
+        std::ifstream inputFile(inputPath, std::ios::binary);
+        if (!inputFile.is_open()) {
+            std::cerr << "Error opening " << inputPath << std::endl;
+            return false;
+        }
+
+        if (packed) {
+            PackedBoard record{};
+            while (inputFile.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+                records.push_back(record);
+            }
+        } else {
+            std::string line;
+            while (std::getline(inputFile, line)) {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::random_device rd;
+    std::mt19937_64 gen(rd());
+
+    if (packed) {
+        std::shuffle(records.begin(), records.end(), gen);
+        outputFile.write(reinterpret_cast<const char *>(records.data()),
+                         static_cast<std::streamsize>(records.size() * sizeof(PackedBoard)));
+        std::cout << "info string Merged " << records.size() << " positions into " << outputPath << std::endl;
+    } else {
+        std::shuffle(lines.begin(), lines.end(), gen);
+        for (const std::string &line: lines) {
             outputFile << line << "\n";
         }
-        outputFile.flush();
-        writeBuffer.clear();
+        std::cout << "info string Merged " << lines.size() << " positions into " << outputPath << std::endl;
     }
-}
\ No newline at end of file
+
+    return outputFile.good();
+}
+
+bool runMerge(std::istream &args) {
+    std::vector<std::string> paths;
+    bool shuffle = false;
+    std::string token;
+    while (args >> token) {
+        if (token == "shuffle") {
+            shuffle = true;
+        } else {
+            paths.push_back(token);
+        }
+    }
+
+    if (paths.size() < 2) {
+        std::cout << "Usage: merge [shuffle] <output> <input>..." << std::endl;
+        return false;
+    }
+
+    return mergeShards(std::vector(paths.begin() + 1, paths.end()), paths.front(), shuffle);
+}
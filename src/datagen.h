@@ -21,8 +21,133 @@
 #define DATAGEN_H
 
 #include <cstdint>
-#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
 
-void generate(int threadId, std::ofstream &outputFile, std::uint64_t positionAmount);
+#include "chess.hpp"
+
+using namespace chess;
+
+// Why a datagen game ended. The packed format stores it in the extra byte
+enum class GameEndReason : std::uint8_t {
+    NATURAL, // Checkmate, stalemate or a draw by the rules
+    WIN_ADJUDICATION,
+    DRAW_ADJUDICATION,
+    TABLEBASE_ADJUDICATION
+};
+
+enum class DatagenFormat {
+    TEXT, // <fen> | <score> | <result>
+    PACKED // 32 byte PackedBoard records
+};
+
+enum class DatagenVariant {
+    STANDARD,
+    FRC, // Both sides share one of the 960 Chess960 start positions
+    DFRC // Every side gets its own Chess960 start position
+};
+
+// The 32 byte board format of marlinformat, which is read by the common NNUE trainers.
+// Score and result are from the point of view of white
+struct PackedBoard {
+    std::uint64_t occupancy; // Pieces in the order of the set bits
+    std::uint8_t pieces[16]; // Two pieces per byte, low nibble first
+    std::uint8_t stmEpSquare; // Side to move in the high bit, en passant square (or 64) in the low bits
+    std::uint8_t halfMoveClock;
+    std::uint16_t fullMoveNumber;
+    std::int16_t score;
+    std::uint8_t wdl; // 0 is a black win, 1 a draw and 2 a white win
+    std::uint8_t extra; // The GameEndReason
+
+    static PackedBoard pack(const Board &board, int score);
+};
+
+static_assert(sizeof(PackedBoard) == 32, "PackedBoard must be 32 bytes");
+
+// Everything a datagen run needs. It is either given as key=value arguments,
+// read from a config file or asked for interactively
+struct DatagenConfig {
+    int threads = 1;
+    std::uint64_t positions = 0;
+    std::uint64_t nodes = 5000;
+    int randomPlies = 10;
+    int maxPlies = 500;
+    std::string out = "output";
+    DatagenFormat format = DatagenFormat::TEXT;
+    DatagenVariant variant = DatagenVariant::STANDARD;
+    std::uint64_t seed = 0; // The master seed, 0 picks a random one
+
+    // A game is won if the score stays above winScore for winPlies plies
+    int winScore = 2500;
+    int winPlies = 5; // 0 disables the win adjudication
+
+    // A game is drawn if the score stays within drawScore for drawPlies plies after the first drawAfter plies
+    int drawScore = 10;
+    int drawPlies = 10; // 0 disables the draw adjudication
+    int drawAfter = 60;
+
+    // Adjudicate with the tablebases, only used if syzygy is set
+    bool tablebaseAdjudication = true;
+    std::string syzygyPath;
+
+    // The position filters, they are applied in this order before a position is written
+    int skipPlies = 0; // Skip the first plies after the opening
+    bool skipChecks = true;
+    bool skipCaptures = true; // Skip if the best move is a capture
+    bool skipPromotions = true; // Skip if the best move is a promotion
+    int maxScore = 10000; // Skip if the absolute score is at least maxScore
+    int qsearchMargin = 0; // Skip if the qsearch score differs more from the static eval, 0 disables the filter
+    int maxGamePositions = 0; // Keep at most this many randomly picked positions of a game, 0 keeps all
+
+    // An EPD or PGN file with the start positions, the random plies are played after the opening
+    std::string bookPath;
+
+    // Games whose opening is scored outside of evalWindow after evalNodes nodes are discarded, 0 disables the filter
+    int evalWindow = 0;
+    std::uint64_t evalNodes = 1000;
+};
+
+// The progress of one shard. It is written next to the shard after every
+// flush, so a killed run can continue where it stopped
+struct DatagenCheckpoint {
+    bool isValid = false;
+    std::uint64_t seed = 0;
+    std::uint64_t games = 0;
+    std::uint64_t positions = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t logBytes = 0;
+    std::uint64_t nextGame = 0; // Every started game takes an index, also the discarded ones
+};
+
+// Parses key=value arguments like threads=64 positions=1e9. Returns false on an unknown key or a bad value
+bool parseDatagenConfig(std::istream &args, DatagenConfig &config);
+
+DatagenConfig askDatagenConfig();
+
+// Runs the datagen threads and reports the progress until enough positions are generated.
+// Returns false if the run couldn't start, e.g. because a shard can't be resumed
+bool runDatagen(const DatagenConfig &config);
+
+// Every thread writes its own shard, so the threads never wait on each other
+void generate(int threadId, const DatagenConfig &config, DatagenCheckpoint checkpoint);
+
+// The name of the shard a thread writes to
+std::string getShardPath(const std::string &out, int threadId, DatagenFormat format);
+
+// Every game has its own seed that only depends on the master seed, the thread and the index of the game.
+// The seed of every written game is logged next to the shard, so each game can be replayed exactly
+std::uint64_t getGameSeed(std::uint64_t masterSeed, int threadId, std::uint64_t gameIndex);
+
+// Writes the FEN of a Chess960 start position, the indices follow the Scharnagl numbering where 518 is the standard position
+void getChess960Fen(std::string &fen, int whiteIndex, int blackIndex);
+
+// Concatenates the shards into one file, optionally in a random order.
+// Files ending in .bin are treated as PackedBoard records, everything else as lines.
+// Every input needs the extension of the output, otherwise nothing is written
+bool mergeShards(const std::vector<std::string> &inputPaths, const std::string &outputPath, bool shuffle);
+
+// Parses "[shuffle] <output> <input>..." and merges the shards, shared by the UCI loop and the command line
+bool runMerge(std::istream &args);
 
 #endif
@@ -18,9 +18,14 @@
 */
 
 #include "helper.h"
+#include "book.h"
+#include "profiler.h"
+#include "syzygy/tbprobe.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <iomanip>
 #include <thread>
 
 void Helper::transpositionTableTest(const tt &transpositionTable) {
@@ -54,41 +59,287 @@ void Helper::transpositionTableTest(const tt &transpositionTable) {
     assert(hashedMove == uci::uciToMove(board, "d5e4"));
 }
 
+bool Helper::tablebaseTest() {
+    if (Tablebase::maxCardinality < 3) {
+        std::cout << "info string The tablebase test needs the 3 men tables, set a SyzygyPath first" << std::endl;
+        return true;
+    }
+
+    struct TablebaseCase {
+        const char *fen;
+        WDLScore wdl;
+
+        // Only the sign is known for most positions, an exact value is checked if it isn't zero
+        int dtzSign;
+        int exactDtz;
+    };
+
+    const TablebaseCase cases[] = {
+        // KRvK is always won for the side with the rook, here it mates in fourteen moves
+        {"8/8/8/4k3/8/8/8/R3K3 w - - 0 1", WDL_WIN, 1, 27},
+        {"8/8/8/4k3/8/8/8/R3K3 b - - 0 1", WDL_LOSS, -1, 0},
+
+        // The black king takes the undefended rook
+        {"8/8/8/8/8/8/8/Rk2K3 b - - 0 1", WDL_DRAW, 0, 0},
+
+        // Rh8 mates at once
+        {"k7/8/1K6/8/8/8/8/7R w - - 0 1", WDL_WIN, 1, 1},
+
+        // The pawn promotes, the zeroing move gives a DTZ of 1
+        {"8/4P3/8/8/8/8/k7/4K3 w - - 0 1", WDL_WIN, 1, 1},
+
+        // With Black to move it is stalemate, with White to move Kd6 and Kd7 promote the pawn
+        {"4k3/4P3/4K3/8/8/8/8/8 b - - 0 1", WDL_DRAW, 0, 0},
+        {"4k3/4P3/4K3/8/8/8/8/8 w - - 0 1", WDL_WIN, 1, 5},
+
+        // The king on the sixth rank in front of the pawn always wins
+        {"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", WDL_WIN, 1, 0},
+        {"4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", WDL_LOSS, -1, 0},
+
+        // The queen mates in seven moves, there is no zeroing move on the way
+        {"8/8/8/4k3/8/8/8/3QK3 w - - 0 1", WDL_WIN, 1, 13},
+        {"8/8/8/4k3/8/8/8/3QK3 b - - 0 1", WDL_LOSS, -1, 0},
+
+        // Black is mated, or stalemated, or takes the undefended queen
+        {"Q6k/8/6K1/8/8/8/8/8 b - - 0 1", WDL_LOSS, -1, -1},
+        {"k7/2Q5/1K6/8/8/8/8/8 b - - 0 1", WDL_DRAW, 0, 0},
+        {"8/8/8/8/8/8/8/Qk2K3 b - - 0 1", WDL_DRAW, 0, 0}
+    };
+
+    Network net;
+    Board board(&net);
+    bool passed = true;
+
+    for (const TablebaseCase &test: cases) {
+        board.setFen(test.fen);
+
+        ProbeState wdlState;
+        const WDLScore wdl = Tablebase::probeWDL(board, &wdlState);
+        ProbeState dtzState;
+        const int dtz = Tablebase::probeDTZ(board, &dtzState);
+
+        const int dtzSign = (dtz > 0) - (dtz < 0);
+        const bool isCorrect = wdlState != ProbeState::FAIL && dtzState != ProbeState::FAIL && wdl == test.wdl &&
+                               dtzSign == test.dtzSign && (test.exactDtz == 0 || dtz == test.exactDtz);
+        passed &= isCorrect;
+
+        std::cout << (isCorrect ? "ok     " : "FAILED ") << test.fen << " | wdl " << wdl << " (expected " << test.wdl
+                << ") | dtz " << dtz << std::endl;
+    }
+
+    std::cout << "info string The tablebase test " << (passed ? "passed" : "failed") << std::endl;
+    return passed;
+}
+
 // Print the uci info
 void Helper::uciPrint() {
     std::cout << "id name Schoenemann" << std::endl
             << "option name Hash type spin default 64 min 1 max 4096" << std::endl
-            << "option name Threads type spin default 1 min 1 max 1" << std::endl;
+            << "option name Threads type spin default 1 min 1 max 1" << std::endl
+            << "option name Ponder type check default false" << std::endl
+            << "option name MultiPV type spin default 1 min 1 max " << MAX_MOVES << std::endl
+            << "option name SyzygyPath type string default <empty>" << std::endl
+            << "option name UCI_Chess960 type check default false" << std::endl
+            << "option name TelemetryFile type string default <empty>" << std::endl;
 }
 
-void Helper::runBenchmark(Search *search, Board &board, SearchParams &params) {
+bool Helper::parseNumber(const std::string &token, int &value) {
+    if (token.empty() || token.size() > 9 || token.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::stoi(token);
+    return true;
+}
+
+void Helper::runBenchmark(Search *search, tt &transpositionTable, Board &board, SearchParams &params,
+                          std::istringstream &args) {
+    // bench [depth] [hash] [threads] [file.epd]
+    int depth = benchDepth;
+    std::uint64_t hashSize = benchHashSize;
+    int threads = 1;
+    std::string path;
+
+    std::string token;
+    int number = 0;
+    const char *usage = "Usage: bench [depth] [hash] [threads] [file.epd]";
+    if (args >> token) {
+        if (!parseNumber(token, number)) {
+            std::cout << "Invalid depth '" << token << "'\n" << usage << std::endl;
+            return;
+        }
+        depth = std::clamp(number, 1, MAX_PLY - 1);
+    }
+    if (args >> token) {
+        if (!parseNumber(token, number)) {
+            std::cout << "Invalid hash '" << token << "'\n" << usage << std::endl;
+            return;
+        }
+        hashSize = std::max(1, number);
+    }
+    if (args >> token) {
+        if (!parseNumber(token, number)) {
+            std::cout << "Invalid threads '" << token << "'\n" << usage << std::endl;
+            return;
+        }
+        threads = number;
+    }
+    args >> path;
+
+    if (threads != 1) {
+        std::cout << "info string The search only supports one thread, the bench uses one thread" << std::endl;
+    }
+
+    std::vector<std::string> positions(std::begin(testStrings), std::end(testStrings));
+    if (!path.empty()) {
+        OpeningBook book;
+        if (!book.load(path)) {
+            return;
+        }
+
+        positions.clear();
+        for (std::size_t i = 0; i < book.size(); i++) {
+            positions.push_back(book.getOpening(i));
+        }
+    }
+
+    // The bench runs on its own table and histories, the ones of the game are put back afterwards.
+    // Swapping the tables keeps a table that was loaded with loadhash without copying it
+    tt benchTable(hashSize);
+    transpositionTable.swap(benchTable);
+    const std::unique_ptr<Search::SavedHistory> savedHistory = search->saveHistory();
+
+    params.depth = depth;
+    params.isInfinite = true;
+
+    // Only our own statistics are printed for every position
+    params.minimal = true;
+
+    std::uint64_t nodes = 0;
+    int maxSelDepth = 0;
+
+    // A hash over the nodes, scores and best moves of every position. It changes with nearly every
+    // change of the search, even if the total amount of nodes stays the same
+    std::uint64_t signature = 0xCBF29CE484222325ULL;
+    auto addToSignature = [&signature](const std::uint64_t value) {
+        signature = (signature ^ value) * 0x100000001B3ULL;
+    };
+
+    // The statistics of the stats command cover the whole bench
+    search->resetStats();
+
+#ifdef PROFILER
+    Profiler::reset();
+    const std::uint64_t profileStart = Profiler::readCycles();
+#endif
+
     // Setting up the clock
     const std::chrono::time_point start = std::chrono::steady_clock::now();
 
-    int nodes = 0;
+    for (std::size_t i = 0; i < positions.size(); i++) {
+        // Every position starts from the same state, so the result doesn't depend on the order of the positions
+        transpositionTable.clear();
+        search->resetHistory();
 
-    params.depth = benchDepth;
-    params.isInfinite = true;
+        board.setFen(positions[i]);
 
-    // Looping over all bench positions
-    for (const std::string &test: testStrings) {
-        board.setFen(test);
+        const std::chrono::time_point positionStart = std::chrono::steady_clock::now();
         search->iterativeDeepening(board, params);
+        const std::chrono::duration<double, std::milli> positionTime = std::chrono::steady_clock::now() - positionStart;
+
         nodes += search->nodes;
+        maxSelDepth = std::max(maxSelDepth, search->selDepth);
+        addToSignature(search->nodes);
+        addToSignature(static_cast<std::uint64_t>(search->currentScore));
+        addToSignature(search->rootBestMove.move());
+
+        std::cout << "Position " << std::setw(3) << i + 1 << "/" << positions.size()
+                << " | Depth " << std::setw(2) << search->completedDepth
+                << " | Seldepth " << std::setw(2) << search->selDepth
+                << " | Nodes " << std::setw(9) << search->nodes
+                << " | Time " << std::setw(6) << static_cast<std::uint64_t>(positionTime.count()) << " ms"
+                << " | Best " << uci::moveToUci(search->rootBestMove, board.chess960())
+                << " | " << positions[i] << std::endl;
     }
 
     const std::chrono::time_point end = std::chrono::steady_clock::now();
 
     // Calculates the total time used
     const std::chrono::duration<double, std::milli> timeElapsed = end - start;
-    const int timeInMs = static_cast<int>(timeElapsed.count());
+    const std::uint64_t timeInMs = static_cast<std::uint64_t>(timeElapsed.count());
 
     // calculates the Nodes per Second
-    const int NPS = static_cast<int>(nodes / timeElapsed.count() * 1000);
+    const std::uint64_t NPS = static_cast<std::uint64_t>(nodes / timeElapsed.count() * 1000);
 
     // Prints out the final bench
     std::cout << "Time  : " << timeInMs << " ms\nNodes : " << nodes << "\nNPS   : " << NPS << std::endl;
+    std::cout << "Max seldepth: " << maxSelDepth << std::endl;
+    std::cout << "Signature: " << std::hex << std::setw(16) << std::setfill('0') << signature << std::dec
+            << std::setfill(' ') << std::endl;
+
+#ifdef PROFILER
+    Profiler::print(profileStart);
+#endif
+
+    // Leave the engine like we found it
+    params.minimal = false;
+    transpositionTable.swap(benchTable);
+    search->restoreHistory(*savedHistory);
+    board.setFen(STARTPOS);
+}
+
+void Helper::runTimeCheckBenchmark(Search *search, TimeManagement &timeManagement, tt &transpositionTable,
+                                   Board &board, SearchParams &params) {
+    params.depth = benchDepth;
+    params.isInfinite = false;
+    params.minimal = true;
+
+    // We compare polling the clock on every node with the amortized polling
+    const int intervals[] = {1, timeCheckInterval};
+    double nps[2] = {};
 
+    // Like the bench this runs on its own table and histories and puts the ones of the game back afterwards
+    tt benchTable(benchHashSize);
+    transpositionTable.swap(benchTable);
+    const std::unique_ptr<Search::SavedHistory> savedHistory = search->saveHistory();
+
+    for (int i = 0; i < 2; i++) {
+        search->nodesPerTimeCheck = intervals[i];
+
+        // Both runs have to start from the same state to search the same tree
+        search->resetHistory();
+        transpositionTable.clear();
+
+        std::uint64_t nodes = 0;
+        const std::chrono::time_point start = std::chrono::steady_clock::now();
+
+        for (const std::string &test: testStrings) {
+            board.setFen(test);
+
+            // A timed search is needed, otherwise the clock is never read.
+            // The move time is large enough to never be reached
+            timeManagement.reset();
+            timeManagement.moveTime = 3600000;
+            timeManagement.isInfiniteSearch = false;
+
+            search->iterativeDeepening(board, params);
+            nodes += search->nodes;
+        }
+
+        const std::chrono::duration<double, std::milli> timeElapsed = std::chrono::steady_clock::now() - start;
+        nps[i] = nodes / timeElapsed.count() * 1000;
+
+        std::cout << "Time check every " << intervals[i] << " nodes | Time: "
+                << static_cast<std::uint64_t>(timeElapsed.count()) << " ms | Nodes: " << nodes
+                << " | NPS: " << static_cast<std::uint64_t>(nps[i]) << std::endl;
+    }
+
+    std::cout << "NPS gain: " << (nps[1] / nps[0] - 1.0) * 100.0 << " %" << std::endl;
+
+    search->nodesPerTimeCheck = timeCheckInterval;
+    params.minimal = false;
+    transpositionTable.swap(benchTable);
+    search->restoreHistory(*savedHistory);
+    timeManagement.reset();
     board.setFen(STARTPOS);
 }
 
@@ -120,20 +371,37 @@ void Helper::handleSetPosition(Board &board, std::istringstream &is, std::string
 
 
 void Helper::handleGo(Search &search, TimeManagement &timeManagement, Board &board,
-                      std::istringstream &is, SearchParams params) {
+                      std::istringstream &is, SearchParams &params) {
 
     // Reset everything for a new search
     params.isInfinite = false;
     params.depth = MAX_PLY;
+    params.ponder = false;
+    params.searchMoves.clear();
 
     search.nodeLimit = Search::NO_NODE_LIMIT;
+    search.resetStats();
     timeManagement.reset();
 
     // Setup values
     std::string token;
     int wtime = -1, btime = -1, winc = 0, binc = 0, movetime = -1;
+    bool isSearchMove = false;
+
+    Movelist legalMoves;
+    movegen::legalmoves(legalMoves, board);
 
     while (is >> token) {
+        // Every token after searchmoves is a move until we find the next keyword
+        if (isSearchMove) {
+            if (const Move move = uci::uciToMove(board, token);
+                std::find(legalMoves.begin(), legalMoves.end(), move) != legalMoves.end()) {
+                params.searchMoves.push_back(move);
+                continue;
+            }
+            isSearchMove = false;
+        }
+
         if (token == "wtime")      { is >> wtime; }
         else if (token == "btime") { is >> btime; }
         else if (token == "winc")  { is >> winc; }
@@ -142,8 +410,13 @@ void Helper::handleGo(Search &search, TimeManagement &timeManagement, Board &boa
         else if (token == "nodes") { is >> search.nodeLimit; }
         else if (token == "movetime") { is >> movetime; }
         else if (token == "infinite") { params.isInfinite = true; }
+        else if (token == "ponder") { params.ponder = true; }
+        else if (token == "searchmoves") { isSearchMove = true; }
     }
 
+    // While pondering the clock is ignored until we receive a ponderhit
+    search.isPondering = params.ponder;
+
     // We search infinite so no time calculation is needed
     if (params.isInfinite) {
         timeManagement.isInfiniteSearch = true;
@@ -26,14 +26,26 @@ class Helper {
 public:
     static void transpositionTableTest(const tt &transpositionTable);
 
-    static void runBenchmark(Search *search, Board &board, SearchParams &params);
+    // Probes known KPvK, KRvK and KQvK positions and compares the WDL and DTZ values.
+    // Needs the 3 men tables, returns true if every probe matched or no tables are loaded
+    static bool tablebaseTest();
+
+    // Searches every bench position from a cleared state and prints the statistics of every position
+    static void runBenchmark(Search *search, tt &transpositionTable, Board &board, SearchParams &params,
+                             std::istringstream &args);
+
+    static void runTimeCheckBenchmark(Search *search, TimeManagement &timeManagement, tt &transpositionTable,
+                                      Board &board, SearchParams &params);
 
     static void uciPrint();
 
+    // Only plain digits are accepted and at most nine of them, so the value always fits into an int
+    static bool parseNumber(const std::string &token, int &value);
+
     static void handleSetPosition(Board &board, std::istringstream &is, std::string &token);
 
     static void handleGo(Search &search, TimeManagement &timeManagement, Board &board, std::istringstream &is,
-                     SearchParams params);
+                         SearchParams &params);
 };
 
 #endif
@@ -27,7 +27,16 @@
 
 DEFINE_PARAM(quietHistoryDiv, 28000, 10000, 50000);
 DEFINE_PARAM(continuationHistoryDiv, 28000, 10000, 50000);
-DEFINE_PARAM(correctionValueDiv, 30, 1, 600);
+// The pawn table alone was tuned with a divisor of 30. Over the bench the weighted sum of all tables is about
+// 2.35 times as large as the pawn entry alone, so the divisor is scaled to start from the same overall correction
+DEFINE_PARAM(correctionValueDiv, 70, 1, 600);
+
+// Correction history weights (in percent)
+DEFINE_PARAM(pawnCorrectionWeight, 100, 50, 150);
+DEFINE_PARAM(nonPawnCorrectionWeight, 60, 20, 120);
+DEFINE_PARAM(minorCorrectionWeight, 50, 20, 100);
+DEFINE_PARAM(majorCorrectionWeight, 50, 20, 100);
+DEFINE_PARAM(continuationCorrectionWeight, 70, 20, 120);
 
 int History::getQuietHistory(const Board &board, const Move move) const {
     return quietHistory[board.sideToMove()][board.at(move.from()).type()][move.to().index()];
@@ -88,26 +97,82 @@ void History::updateContinuationHistory(const PieceType piece, const Move move,
     }
 }
 
-void History::updatePawnCorrectionHistory(const int bonus, const Board &board, const int div) {
-    const std::uint64_t pawnHash = getPieceKey(PieceType::PAWN, board);
+void History::applyCorrectionGravity(int &entry, const int bonus, const int div) {
+    entry += bonus - entry * std::abs(bonus) / div;
+}
+
+void History::updateCorrectionHistory(const int bonus, const Board &board, const int div, const int ply,
+                                      const SearchStack *stack) {
+    const Color stm = board.sideToMove();
+    const std::uint16_t mask = correctionHistorySize - 1;
+
+    const std::uint64_t pawnKey = getPieceKey(PieceType::PAWN, board);
+    const std::uint64_t minorKey = getBitboardKey(
+        board.pieces(PieceType::KNIGHT) | board.pieces(PieceType::BISHOP) | board.pieces(PieceType::KING), board);
+    const std::uint64_t majorKey = getBitboardKey(
+        board.pieces(PieceType::ROOK) | board.pieces(PieceType::QUEEN) | board.pieces(PieceType::KING), board);
+
     // Gravity
-    const int scaledBonus = bonus - pawnCorrectionHistory[board.sideToMove()][
-                                pawnHash & pawnCorrectionHistorySize - 1] * std::abs(bonus) / div;
-    pawnCorrectionHistory[board.sideToMove()][pawnHash & pawnCorrectionHistorySize - 1] += scaledBonus;
+    applyCorrectionGravity(pawnCorrectionHistory[stm][pawnKey & mask], bonus, div);
+    for (int color = 0; color < 2; color++) {
+        const std::uint64_t nonPawnKey = getBitboardKey(board.us(color) & ~board.pieces(PieceType::PAWN), board);
+        applyCorrectionGravity(nonPawnCorrectionHistory[stm][color][nonPawnKey & mask], bonus, div);
+    }
+    applyCorrectionGravity(minorCorrectionHistory[stm][minorKey & mask], bonus, div);
+    applyCorrectionGravity(majorCorrectionHistory[stm][majorKey & mask], bonus, div);
+
+    // The continuation correction is indexed by the move that led to this position
+    if (ply > 0 && stack[ply - 1].previousMovedPiece != PieceType::NONE) {
+        applyCorrectionGravity(continuationCorrectionHistory[stm]
+                               [stack[ply - 1].previousMovedPiece]
+                               [stack[ply - 1].previousMove.to().index()], bonus, div);
+    }
 }
 
-int History::correctEval(const int rawEval, const Board &board) const {
-    const int pawnEntry = pawnCorrectionHistory[board.sideToMove()][
-        getPieceKey(PieceType::PAWN, board) & pawnCorrectionHistorySize - 1];
+int History::correctEval(const int rawEval, const Board &board, const int ply, const SearchStack *stack) const {
+    const Color stm = board.sideToMove();
+    const std::uint16_t mask = correctionHistorySize - 1;
 
-    const int corrHistoryBonus = pawnEntry;
+    const int pawnEntry = pawnCorrectionHistory[stm][getPieceKey(PieceType::PAWN, board) & mask];
 
-    return rawEval + corrHistoryBonus / correctionValueDiv;
+    // The non-pawn tables are kept separately for each color
+    int nonPawnEntry = 0;
+    for (int color = 0; color < 2; color++) {
+        nonPawnEntry += nonPawnCorrectionHistory[stm][color][
+            getBitboardKey(board.us(color) & ~board.pieces(PieceType::PAWN), board) & mask];
+    }
+
+    const int minorEntry = minorCorrectionHistory[stm][
+        getBitboardKey(board.pieces(PieceType::KNIGHT) | board.pieces(PieceType::BISHOP) |
+                       board.pieces(PieceType::KING), board) & mask];
+
+    const int majorEntry = majorCorrectionHistory[stm][
+        getBitboardKey(board.pieces(PieceType::ROOK) | board.pieces(PieceType::QUEEN) |
+                       board.pieces(PieceType::KING), board) & mask];
+
+    int continuationEntry = 0;
+    if (ply > 0 && stack[ply - 1].previousMovedPiece != PieceType::NONE) {
+        continuationEntry = continuationCorrectionHistory[stm]
+                [stack[ply - 1].previousMovedPiece]
+                [stack[ply - 1].previousMove.to().index()];
+    }
+
+    // Every table is weighted in percent
+    const int corrHistoryBonus = pawnEntry * pawnCorrectionWeight +
+                                 nonPawnEntry * nonPawnCorrectionWeight +
+                                 minorEntry * minorCorrectionWeight +
+                                 majorEntry * majorCorrectionWeight +
+                                 continuationEntry * continuationCorrectionWeight;
+
+    return rawEval + corrHistoryBonus / (correctionValueDiv * 100);
 }
 
 std::uint64_t History::getPieceKey(const PieceType piece, const Board &board) {
+    return getBitboardKey(board.pieces(piece), board);
+}
+
+std::uint64_t History::getBitboardKey(Bitboard bitboard, const Board &board) {
     std::uint64_t key = 0;
-    Bitboard bitboard = board.pieces(piece);
     while (bitboard) {
         const Square square = bitboard.pop();
         key ^= Zobrist::piece(board.at(square), square);
@@ -119,4 +184,8 @@ void History::resetHistories() {
     std::memset(&quietHistory, 0, sizeof(quietHistory));
     std::memset(&continuationHistory, 0, sizeof(continuationHistory));
     std::memset(&pawnCorrectionHistory, 0, sizeof(pawnCorrectionHistory));
+    std::memset(&nonPawnCorrectionHistory, 0, sizeof(nonPawnCorrectionHistory));
+    std::memset(&minorCorrectionHistory, 0, sizeof(minorCorrectionHistory));
+    std::memset(&majorCorrectionHistory, 0, sizeof(majorCorrectionHistory));
+    std::memset(&continuationCorrectionHistory, 0, sizeof(continuationCorrectionHistory));
 }
@@ -25,22 +25,30 @@ class History {
     int quietHistory[2][7][64] = {};
     int continuationHistory[6][64][6][64] = {};
     int pawnCorrectionHistory[2][16384] = {};
+    int nonPawnCorrectionHistory[2][2][16384] = {};
+    int minorCorrectionHistory[2][16384] = {};
+    int majorCorrectionHistory[2][16384] = {};
+    int continuationCorrectionHistory[2][6][64] = {};
 
 private:
     static std::uint64_t getPieceKey(PieceType piece, const Board &board);
 
-    const std::uint16_t pawnCorrectionHistorySize = 16384;
+    static std::uint64_t getBitboardKey(Bitboard bitboard, const Board &board);
+
+    static void applyCorrectionGravity(int &entry, int bonus, int div);
+
+    static constexpr std::uint16_t correctionHistorySize = 16384;
 
 public:
     [[nodiscard]] int getQuietHistory(const Board &board, Move move) const;
 
     int getContinuationHistory(PieceType piece, Move move, int ply, const SearchStack *stack) const;
 
-    int correctEval(int rawEval, const Board &board) const;
+    int correctEval(int rawEval, const Board &board, int ply, const SearchStack *stack) const;
 
     void updateQuietHistory(const Board &board, Move move, int bonus);
 
-    void updatePawnCorrectionHistory(int bonus, const Board &board, int div);
+    void updateCorrectionHistory(int bonus, const Board &board, int div, int ply, const SearchStack *stack);
 
     void updateContinuationHistory(PieceType piece, Move move, int bonus, int ply, const SearchStack *stack);
 
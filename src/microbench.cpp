@@ -0,0 +1,259 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Times the hot kernels of the engine in isolation over the bench positions.
+// Usage: microbench [samples] [kernel]
+// Every kernel does the same work on every run, so the numbers can be compared between commits
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "consts.h"
+#include "moveorder.h"
+#include "see.h"
+#include "tt.h"
+#include "NNUE/nnue.h"
+
+namespace {
+    // Every kernel adds its results here, so the compiler can't remove the work
+    std::uint64_t sink = 0;
+
+    struct Kernel {
+        const char *name;
+
+        // Runs the kernel once over all positions and returns the amount of operations
+        std::function<std::uint64_t()> run;
+    };
+
+    struct Position {
+        Board board;
+        Movelist moves;
+    };
+
+    void runKernel(const Kernel &kernel, const int samples) {
+        // The first run warms up the caches and the branch predictors
+        kernel.run();
+
+        std::vector<double> nsPerOp;
+        std::uint64_t operations = 0;
+        for (int i = 0; i < samples; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            operations = kernel.run();
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            nsPerOp.push_back(elapsed.count() / static_cast<double>(operations));
+        }
+
+        double mean = 0;
+        for (const double value: nsPerOp) {
+            mean += value;
+        }
+        mean /= samples;
+
+        double variance = 0;
+        for (const double value: nsPerOp) {
+            variance += (value - mean) * (value - mean);
+        }
+        variance /= std::max(1, samples - 1);
+        const double deviation = std::sqrt(variance);
+
+        std::cout << std::left << std::setw(20) << kernel.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(10) << mean << " ns/op  +- " << std::setw(6) << deviation
+                << " (" << std::setw(5) << (mean > 0 ? 100.0 * deviation / mean : 0.0) << " %)"
+                << "  min " << std::setw(8) << *std::min_element(nsPerOp.begin(), nsPerOp.end())
+                << "  ops " << operations << std::endl;
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    const int samples = argc > 1 ? std::max(2, std::atoi(argv[1])) : 10;
+    const std::string filter = argc > 2 ? argv[2] : "";
+
+    // The net is too large for the stack
+    const auto net = std::make_unique<Network>();
+
+    // The boards are set up once, setFen refreshes the accumulator and would dominate most kernels.
+    // All boards share the net, which is fine since no kernel depends on the accumulator of its board
+    std::vector<Position> positions;
+    positions.reserve(std::size(testStrings));
+    for (const std::string &fen: testStrings) {
+        Position &position = positions.emplace_back(Position{Board(net.get(), fen), {}});
+        movegen::legalmoves(position.moves, position.board);
+    }
+
+    const auto history = std::make_unique<History>();
+    const auto stack = std::make_unique<SearchStack[]>(MAX_PLY);
+    const tt transpositionTable(16);
+
+    // The keys of the tt kernels, a fixed seed keeps them equal between runs
+    std::vector<std::uint64_t> keys(1 << 16);
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (std::uint64_t &key: keys) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        key = state;
+    }
+
+    const std::vector<Kernel> kernels = {
+        {
+            "legalmoves", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 200; repeat++) {
+                    for (Position &position: positions) {
+                        Board &board = position.board;
+                        for (int i = 0; i < 10; i++) {
+                            Movelist moveList;
+                            movegen::legalmoves(moveList, board);
+                            sink += moveList.size();
+                            operations++;
+                        }
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "makeMove+unmakeMove", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 100; repeat++) {
+                    for (Position &position: positions) {
+                        Board &board = position.board;
+                        for (const Move &move: position.moves) {
+                            board.makeMove(move);
+                            board.unmakeMove(move);
+                            operations++;
+                        }
+                        sink += board.hash();
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "updateAccumulator", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 2000; repeat++) {
+                    for (std::uint8_t square = 0; square < 64; square++) {
+                        const std::uint8_t piece = square % 6;
+                        const std::uint8_t color = square / 32;
+                        net->updateAccumulator(piece, color, square, true);
+                        net->updateAccumulator(piece, color, square, false);
+                        operations += 2;
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "forward", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 100; repeat++) {
+                    for (Position &position: positions) {
+                        Board &board = position.board;
+                        for (int i = 0; i < 20; i++) {
+                            sink += net->evaluate(board.sideToMove(), board.occ().count());
+                            operations++;
+                        }
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "SEE::see", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 200; repeat++) {
+                    for (Position &position: positions) {
+                        Board &board = position.board;
+                        for (const Move &move: position.moves) {
+                            sink += SEE::see(board, move, 0);
+                            operations++;
+                        }
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "orderMoves", [&] {
+                std::uint64_t operations = 0;
+                int scores[MAX_MOVES];
+                for (int repeat = 0; repeat < 200; repeat++) {
+                    for (Position &position: positions) {
+                        Board &board = position.board;
+                        for (int i = 0; i < 5; i++) {
+                            Movelist moveList = position.moves;
+                            MoveOrder::orderMoves(history.get(), moveList, nullptr, Move::NULL_MOVE, stack.get(),
+                                                  board, scores, 0);
+                            sink += scores[0];
+                            operations++;
+                        }
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "tt store", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 20; repeat++) {
+                    for (const std::uint64_t key: keys) {
+                        transpositionTable.storeHash(key, repeat, Bound::EXACT, 0, Move::NULL_MOVE, 0);
+                        operations++;
+                    }
+                }
+                return operations;
+            }
+        },
+        {
+            "tt probe", [&] {
+                std::uint64_t operations = 0;
+                for (int repeat = 0; repeat < 20; repeat++) {
+                    for (const std::uint64_t key: keys) {
+                        const Hash *entry = transpositionTable.getHash(key);
+                        sink += entry != nullptr && entry->key == key;
+                        operations++;
+                    }
+                }
+                return operations;
+            }
+        }
+    };
+
+    std::cout << "Kernel timings over " << positions.size() << " positions with " << samples << " samples"
+            << std::endl;
+    for (const Kernel &kernel: kernels) {
+        if (filter.empty() || filter == kernel.name) {
+            runKernel(kernel, samples);
+        }
+    }
+
+    // Printing the sink keeps the work alive
+    std::cout << "Checksum: " << sink << std::endl;
+    return 0;
+}
@@ -20,11 +20,14 @@
 #include "moveorder.h"
 #include "see.h"
 #include "tune.h"
+#include "profiler.h"
 
 DEFINE_PARAM(mvaLvvMultiplyer, 103, 83, 123);
 
 void MoveOrder::orderMoves(const History *history, Movelist &moveList, const Hash *entry, const Move &killer,
                            const SearchStack *stack, const Board &board, int *scores, const int &ply) {
+    PROFILE_SCOPE(ORDERING);
+
     const bool isNullptr = entry == nullptr;
     const std::uint64_t key = board.zobrist();
 
@@ -0,0 +1,203 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "perft.h"
+#include "NNUE/nnue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Subtree counts are shared between the threads without a lock. The check word is the key xor the data,
+    // so an entry that was torn by two writers doesn't match anymore and is ignored
+    struct PerftEntry {
+        std::atomic<std::uint64_t> check;
+        std::atomic<std::uint64_t> data;
+    };
+
+    class PerftCache {
+    public:
+        explicit PerftCache(const std::uint64_t sizeMB) {
+            if (sizeMB == 0) {
+                return;
+            }
+
+            // A power of two keeps the index a simple mask
+            std::uint64_t count = 1;
+            while (count * 2 * sizeof(PerftEntry) <= sizeMB * 1024 * 1024) {
+                count *= 2;
+            }
+            entries = std::make_unique<PerftEntry[]>(count);
+            mask = count - 1;
+        }
+
+        [[nodiscard]] bool probe(const std::uint64_t key, const int depth, std::uint64_t &nodes) const {
+            if (!entries) {
+                return false;
+            }
+
+            const PerftEntry &entry = entries[index(key, depth)];
+            const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+            if ((entry.check.load(std::memory_order_relaxed) ^ data) != key || (data & 0xFF) != static_cast<std::uint64_t>(depth)) {
+                return false;
+            }
+
+            nodes = data >> 8;
+            return true;
+        }
+
+        void store(const std::uint64_t key, const int depth, const std::uint64_t nodes) const {
+            if (!entries) {
+                return;
+            }
+
+            // The upper 56 bits are enough for any depth that finishes in reasonable time
+            const std::uint64_t data = nodes << 8 | static_cast<std::uint64_t>(depth);
+            PerftEntry &entry = entries[index(key, depth)];
+            entry.check.store(key ^ data, std::memory_order_relaxed);
+            entry.data.store(data, std::memory_order_relaxed);
+        }
+
+    private:
+        std::unique_ptr<PerftEntry[]> entries;
+        std::uint64_t mask = 0;
+
+        // The same position is stored at different depths, so the depth is mixed into the index
+        [[nodiscard]] std::uint64_t index(const std::uint64_t key, const int depth) const {
+            return (key ^ static_cast<std::uint64_t>(depth) * 0x9E3779B97F4A7C15ULL) & mask;
+        }
+    };
+
+    std::uint64_t perftCached(Board &board, const int depth, const PerftCache &cache) {
+        if (depth <= 1) {
+            return Perft::perft(board, depth);
+        }
+
+        std::uint64_t nodes = 0;
+        const std::uint64_t key = board.hash();
+        if (cache.probe(key, depth, nodes)) {
+            return nodes;
+        }
+
+        Movelist moveList;
+        movegen::legalmoves(moveList, board);
+        for (const Move &move: moveList) {
+            board.makeMove(move);
+            nodes += perftCached(board, depth - 1, cache);
+            board.unmakeMove(move);
+        }
+
+        cache.store(key, depth, nodes);
+        return nodes;
+    }
+}
+
+std::uint64_t Perft::perft(Board &board, const int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+
+    Movelist moveList;
+    movegen::legalmoves(moveList, board);
+
+    // Bulk counting, every legal move of the last ply is a leaf
+    if (depth == 1) {
+        return moveList.size();
+    }
+
+    std::uint64_t nodes = 0;
+    for (const Move &move: moveList) {
+        board.makeMove(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove(move);
+    }
+    return nodes;
+}
+
+void Perft::run(const Board &board, std::istringstream &is) {
+    int depth = 0;
+    int threads = 1;
+    std::uint64_t hashSize = 16;
+
+    std::string token;
+    is >> depth;
+    while (is >> token) {
+        if (token == "threads") { is >> threads; }
+        else if (token == "hash") { is >> hashSize; }
+    }
+
+    if (depth < 1) {
+        std::cout << "info string Usage: go perft <depth> [threads <n>] [hash <mb>]" << std::endl;
+        return;
+    }
+
+    Movelist rootMoves;
+    movegen::legalmoves(rootMoves, board);
+
+    threads = std::clamp(threads, 1, std::max(1, rootMoves.size()));
+
+    const PerftCache cache(hashSize);
+    std::vector<std::uint64_t> rootNodes(rootMoves.size());
+    std::atomic<int> nextRootMove{0};
+
+    const std::string fen = board.getFen();
+    const bool chess960 = board.chess960();
+
+    // Every thread takes the next unsearched root move, so the threads finish close to each other
+    auto worker = [&] {
+        // Every board updates the accumulator of its net, so every thread needs its own
+        const auto net = std::make_unique<Network>();
+        Board threadBoard(net.get(), fen, chess960);
+
+        for (int i = nextRootMove++; i < rootMoves.size(); i = nextRootMove++) {
+            threadBoard.makeMove(rootMoves[i]);
+            rootNodes[i] = perftCached(threadBoard, depth - 1, cache);
+            threadBoard.unmakeMove(rootMoves[i]);
+        }
+    };
+
+    const std::chrono::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread: workers) {
+        thread.join();
+    }
+
+    const std::chrono::duration<double, std::milli> timeElapsed = std::chrono::steady_clock::now() - start;
+
+    std::uint64_t nodes = 0;
+    for (int i = 0; i < rootMoves.size(); i++) {
+        std::cout << uci::moveToUci(rootMoves[i], chess960) << ": " << rootNodes[i] << std::endl;
+        nodes += rootNodes[i];
+    }
+
+    const std::uint64_t timeInMs = static_cast<std::uint64_t>(timeElapsed.count());
+    const std::uint64_t nps = static_cast<std::uint64_t>(nodes / std::max(timeElapsed.count(), 1.0) * 1000);
+
+    std::cout << "\nNodes searched: " << nodes << "\nTime  : " << timeInMs << " ms\nNPS   : " << nps << std::endl;
+}
@@ -0,0 +1,41 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint>
+#include <sstream>
+
+#include "chess.hpp"
+
+using namespace chess;
+
+// Counts the leaf nodes of the legal move tree, used to verify and benchmark the move generation
+class Perft {
+public:
+    // perft <depth> [threads <n>] [hash <mb>]
+    // Prints the node count below every root move and the total, the root moves are split across the threads
+    static void run(const Board &board, std::istringstream &is);
+
+    // The moves of the last ply are counted without playing them
+    static std::uint64_t perft(Board &board, int depth);
+};
+
+#endif
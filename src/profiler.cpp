@@ -0,0 +1,70 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "profiler.h"
+
+#ifdef PROFILER
+
+#include <iomanip>
+#include <iostream>
+
+thread_local Profiler::Counters Profiler::counters;
+
+namespace {
+    const char *phaseNames[] = {
+        "legalmoves",
+        "orderMoves",
+        "updateAccumulator",
+        "evaluate",
+        "SEE::see",
+        "getHash"
+    };
+}
+
+void Profiler::reset() {
+    counters = Counters{};
+}
+
+void Profiler::print(const std::uint64_t startCycles) {
+    const std::uint64_t total = readCycles() - startCycles;
+
+    std::uint64_t profiled = 0;
+    for (const std::uint64_t cycles: counters.cycles) {
+        profiled += cycles;
+    }
+
+    auto printPhase = [total](const char *name, const std::uint64_t cycles, const std::uint64_t calls) {
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(7) << (total > 0 ? 100.0 * static_cast<double>(cycles) / static_cast<double>(total) : 0.0)
+                << " %  " << std::setw(14) << cycles << " cycles";
+        if (calls > 0) {
+            std::cout << "  " << std::setw(12) << calls << " calls  " << std::setw(8)
+                    << static_cast<double>(cycles) / static_cast<double>(calls) << " cycles/call";
+        }
+        std::cout << std::endl;
+    };
+
+    std::cout << "Profile, the share of the cycles spent in every phase without its nested phases" << std::endl;
+    for (int i = 0; i < static_cast<int>(ProfilePhase::COUNT); i++) {
+        printPhase(phaseNames[i], counters.cycles[i], counters.calls[i]);
+    }
+    printPhase("other", total > profiled ? total - profiled : 0, 0);
+}
+
+#endif
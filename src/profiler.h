@@ -0,0 +1,111 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+
+// Measures how the cycles of a search split between the hot kernels. It is only compiled in with PROFILER
+// (make profile), otherwise every PROFILE_SCOPE is removed by the preprocessor
+
+enum class ProfilePhase : std::uint8_t {
+    MOVEGEN,
+    ORDERING,
+    ACCUMULATOR,
+    FORWARD,
+    SEE,
+    TT_PROBE,
+    COUNT
+};
+
+#ifdef PROFILER
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+class Profiler {
+public:
+    // The counters belong to the calling thread, so the search threads don't share a cache line
+    struct Counters {
+        std::uint64_t cycles[static_cast<int>(ProfilePhase::COUNT)] = {};
+        std::uint64_t calls[static_cast<int>(ProfilePhase::COUNT)] = {};
+
+        // The cycles of the scopes that are nested in the currently open scope
+        std::uint64_t childCycles = 0;
+    };
+
+    static thread_local Counters counters;
+
+    // Without a time stamp counter nanoseconds are reported instead of cycles
+    static std::uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static void reset();
+
+    // Prints the share of every phase of the cycles since the given start
+    static void print(std::uint64_t startCycles);
+};
+
+// Adds the cycles between the construction and the destruction to a phase.
+// A nested scope is only counted in its own phase, so the shares never overlap.
+// Reading the counter costs a few dozen cycles, which inflates the shares of short phases like getHash
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const ProfilePhase profilePhase) : phase(profilePhase), start(Profiler::readCycles()),
+                                                            outerChildCycles(Profiler::counters.childCycles) {
+        Profiler::counters.childCycles = 0;
+    }
+
+    ~ScopedTimer() {
+        const std::uint64_t elapsed = Profiler::readCycles() - start;
+        Profiler::Counters &counters = Profiler::counters;
+        counters.cycles[static_cast<int>(phase)] += elapsed - counters.childCycles;
+        counters.calls[static_cast<int>(phase)]++;
+        counters.childCycles = outerChildCycles + elapsed;
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    ProfilePhase phase;
+    std::uint64_t start;
+    std::uint64_t outerChildCycles;
+};
+
+#define PROFILE_SCOPE(phase) const ScopedTimer profileScope(ProfilePhase::phase)
+#else
+#define PROFILE_SCOPE(phase) static_cast<void>(0)
+#endif
+
+#endif
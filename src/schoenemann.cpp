@@ -37,12 +37,12 @@
 #include "tt.h"
 #include "timeman.h"
 #include "see.h"
+#include "perft.h"
+#include "telemetry.h"
+#include "analyse.h"
+#include "syzygy/tbprobe.h"
 
 
-// Define global shared resources for multithreading
-std::mutex outputFileMutex;
-std::atomic<std::uint64_t> totalPositionsGenerated(0);
-
 int main(int argc, char *argv[]) {
     std::uint32_t transpositionTableSize = 16;
 
@@ -79,12 +79,62 @@ int main(int argc, char *argv[]) {
     auto stopSearch = [&]() {
         if (searchThread.joinable()) {
             search->shouldStop = true;
+            search->isPondering = false;
             searchThread.join();
         }
     };
 
+    // ./null bench [depth] [hash] [threads] [file.epd]
     if (argc > 1 && std::strcmp(argv[1], "bench") == 0) {
-        Helper::runBenchmark(search.get(), board, params);
+        std::string arguments;
+        for (int i = 2; i < argc; i++) {
+            arguments += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(arguments);
+        Helper::runBenchmark(search.get(), transpositionTable, board, params, is);
+        return 0;
+    }
+
+    // ./null datagen threads=64 positions=1e9 nodes=5000 out=data seed=1
+    if (argc > 1 && std::strcmp(argv[1], "datagen") == 0) {
+        std::string arguments;
+        for (int i = 2; i < argc; i++) {
+            arguments += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(arguments);
+        DatagenConfig config;
+        if (!parseDatagenConfig(is, config)) {
+            return 1;
+        }
+        return runDatagen(config) ? 0 : 1;
+    }
+
+    // ./null merge [shuffle] data.bin data_0.bin data_1.bin
+    if (argc > 1 && std::strcmp(argv[1], "merge") == 0) {
+        std::string arguments;
+        for (int i = 2; i < argc; i++) {
+            arguments += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(arguments);
+        return runMerge(is) ? 0 : 1;
+    }
+
+    // ./null analyse positions.epd depth=12 threads=8 out=results.txt
+    if (argc > 1 && std::strcmp(argv[1], "analyse") == 0) {
+        std::string arguments;
+        for (int i = 2; i < argc; i++) {
+            arguments += std::string(argv[i]) + " ";
+        }
+
+        std::istringstream is(arguments);
+        AnalyseConfig config;
+        if (!parseAnalyseConfig(is, config)) {
+            return 1;
+        }
+        runAnalyse(config);
         return 0;
     }
 
@@ -109,6 +159,9 @@ int main(int argc, char *argv[]) {
             std::cout << "uciok" << std::endl;
         } else if (token == "stop") {
             stopSearch();
+        } else if (token == "ponderhit") {
+            // The opponent played the expected move, so we continue with a normal timed search
+            search->isPondering = false;
         } else if (token == "isready") {
             std::cout << "readyok" << std::endl;
         } else if (token == "ucinewgame") {
@@ -151,6 +204,39 @@ int main(int argc, char *argv[]) {
                         transpositionTable.clear();
                         transpositionTable.setSize(transpositionTableSize);
                     }
+                } else if (token == "MultiPV") {
+                    is >> token;
+                    if (token == "value") {
+                        is >> token;
+                        if (int lines = 0; Helper::parseNumber(token, lines)) {
+                            search->multiPV = std::clamp(lines, 1, MAX_MOVES);
+                        } else {
+                            std::cout << "info string Invalid value for MultiPV: '" << token << "'" << std::endl;
+                        }
+                    }
+                } else if (token == "SyzygyPath") {
+                    is >> token;
+                    if (token == "value") {
+                        // The path may contain spaces, so we take the rest of the line
+                        std::string path;
+                        std::getline(is >> std::ws, path);
+                        Tablebase::init(path);
+                    }
+                } else if (token == "TelemetryFile") {
+                    is >> token;
+                    if (token == "value") {
+                        // The path may contain spaces, so we take the rest of the line
+                        std::string path;
+                        std::getline(is >> std::ws, path);
+                        Telemetry::open(path);
+                    }
+                } else if (token == "UCI_Chess960") {
+                    is >> token;
+                    if (token == "value") {
+                        is >> token;
+                        // Changes how castling rights are read and how castling moves are sent and received
+                        board.set960(token == "true");
+                    }
                 }
             }
         } else if (token == "position") {
@@ -161,7 +247,18 @@ int main(int argc, char *argv[]) {
             stopSearch();
             search->shouldStop = false;
 
-            Helper::handleGo(*search, timeManagement, board, is, params);
+            // go perft <depth> runs in the foreground, it can't be stopped
+            std::string arguments;
+            std::getline(is >> std::ws, arguments);
+            std::istringstream goArgs(arguments);
+            if (goArgs >> token && token == "perft") {
+                Perft::run(board, goArgs);
+                continue;
+            }
+
+            goArgs.clear();
+            goArgs.str(arguments);
+            Helper::handleGo(*search, timeManagement, board, goArgs, params);
             searchThread = std::thread([&] {
                 search->iterativeDeepening(board, params);
             });
@@ -170,87 +267,69 @@ int main(int argc, char *argv[]) {
         } else if (token == "fen") {
             std::cout << board.getFen() << std::endl;
         } else if (token == "datagen") {
-            int numThreads;
-            std::uint64_t positionAmount;
-
-            std::cout << "Enter the number of threads to use (press Enter to use half of the available threads): ";
-            std::string threadInput;
-            std::getline(std::cin, threadInput);
-
-            if (threadInput.empty()) {
-                numThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
+            // datagen threads=64 positions=1e9 ... or without arguments interactively
+            DatagenConfig config;
+            bool isValidConfig = true;
+            if (is >> std::ws && is.peek() != EOF) {
+                isValidConfig = parseDatagenConfig(is, config);
             } else {
-                try {
-                    numThreads = std::stoi(threadInput);
-                } catch ([[maybe_unused]] const std::invalid_argument &ia) {
-                    std::cerr << "Invalid number of threads. Using half of the available threads." << std::endl;
-                    numThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
-                }
+                config = askDatagenConfig();
             }
 
-            std::cout << "Enter the number of positions to generate: ";
-            std::cin >> positionAmount;
-            // Consume the rest of the line
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Starting datagen with " << numThreads << " threads." << std::endl;
-
-            // Open the output file once in append mode
-            std::ofstream outputFile("output.txt", std::ios::app);
-            if (!outputFile.is_open()) {
-                std::cerr << "Error opening output file for datagen!" << std::endl;
-                return 1;
+            if (isValidConfig) {
+                runDatagen(config);
             }
-
-            std::vector<std::thread> threads;
-            for (int i = 0; i < numThreads; ++i) {
-                // Launch each thread to run the 'generate' function
-                threads.emplace_back(generate, i, std::ref(outputFile), positionAmount);
+        } else if (token == "analyse") {
+            // analyse <file.epd> depth=N|nodes=N|movetime=N threads=T out=<file>
+            stopSearch();
+            AnalyseConfig config;
+            if (parseAnalyseConfig(is, config)) {
+                runAnalyse(config);
             }
-
-            // Periodically print statistics from the main thread
-            auto startTime = std::chrono::steady_clock::now();
-            while (totalPositionsGenerated < positionAmount) {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(
-                    std::chrono::steady_clock::now() - startTime).count();
-                if (elapsedTime > 0) {
-                    // Use .load() for safe reading of atomic variable
-                    auto currentPositions = totalPositionsGenerated.load();
-                    double pps = static_cast<double>(currentPositions) / elapsedTime;
-
-                    // Ensure ETA is never negative
-                    double eta = (pps > 0 && currentPositions < positionAmount)
-                                     ? (positionAmount - currentPositions) / pps
-                                     : 0.0;
-
-                    // Cap displayed progress at 100%
-                    double progress = std::min(100.0, static_cast<double>(currentPositions) / positionAmount * 100.0);
-
-                    std::cout << "\r" << std::fixed << std::setprecision(2)
-                            << "Progress: " << progress << "% | "
-                            << "Positions: " << currentPositions << "/" << positionAmount << " | "
-                            << "PPS: " << static_cast<int>(pps) << " | "
-                            << "ETA: " << static_cast<int>(eta) << "s   " << std::flush;
-                }
+        } else if (token == "merge") {
+            // merge [shuffle] <output> <input>...
+            runMerge(is);
+        } else if (token == "bench") {
+            stopSearch();
+            std::string arguments;
+            std::getline(is >> std::ws, arguments);
+            if (arguments == "timecheck") {
+                Helper::runTimeCheckBenchmark(search.get(), timeManagement, transpositionTable, board, params);
+            } else {
+                std::istringstream benchArgs(arguments);
+                Helper::runBenchmark(search.get(), transpositionTable, board, params, benchArgs);
             }
+        } else if (token == "savehash" || token == "loadhash") {
+            stopSearch();
 
-            // Print the progress bar
-            std::cout << "\r" << std::fixed << std::setprecision(2)
-                    << "Progress: " << 100.00 << "% | "
-                    << "Positions: " << positionAmount << "/" << positionAmount << " | "
-                    << "PPS: " << 0 << " | "
-                    << "ETA: " << 0 << "s   " << std::endl;
-
-
-            // The program will run indefinitely; this join part is for graceful shutdown logic
-            for (std::thread &t: threads) {
-                if (t.joinable()) {
-                    t.join();
-                }
+            // The path may contain spaces, so we take the rest of the line
+            const std::string command = token;
+            std::string path;
+            std::getline(is >> std::ws, path);
+
+            if (path.empty()) {
+                std::cout << "info string Usage: " << command << " <file>" << std::endl;
+            } else if (command == "savehash") {
+                std::cout << "info string " << (transpositionTable.save(path) ? "Saved" : "Failed to save")
+                        << " the hash to " << path << std::endl;
+            } else if (transpositionTable.load(path)) {
+                std::cout << "info string Loaded " << transpositionTable.getSizeMB() << " MB of hash from " << path
+                        << std::endl;
+            } else {
+                std::cout << "info string Failed to load the hash from " << path << std::endl;
             }
-            outputFile.close();
-        } else if (token == "bench") {
-            Helper::runBenchmark(search.get(), board, params);
+        } else if (token == "tbtest") {
+            // tbtest [path], without a path the tables of the SyzygyPath option are used
+            stopSearch();
+            std::string path;
+            std::getline(is >> std::ws, path);
+            if (!path.empty()) {
+                Tablebase::init(path);
+            }
+            Helper::tablebaseTest();
+        } else if (token == "stats") {
+            stopSearch();
+            search->printStats();
         } else if (token == "eval") {
             std::cout << "The raw eval is: " << net.evaluate(board.sideToMove(), board.occ().count()) << std::endl;
             std::cout << "The scaled evaluation is: " << Search::scaleOutput(
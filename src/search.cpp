@@ -17,13 +17,18 @@
   along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cmath>
 #include <chrono>
 #include <cassert>
 #include <memory>
+#include <sstream>
+#include <thread>
 
 #include "search.h"
 #include "see.h"
+#include "syzygy/tbprobe.h"
+#include "telemetry.h"
 #include "tune.h"
 #include "tunables.h"
 
@@ -44,15 +49,16 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     }
 
     // We check for a timeout
-    if (timeManagement.shouldStopSoft(start) || nodes >= nodeLimit) {
-        shouldStop = true;
-    }
+    checkTime();
 
     // If depth is 0 we drop into qs to get a neutral position
     if (depth <= 0) {
         return qs(alpha, beta, board, ply);
     }
 
+    SEARCH_STAT(pvsNodes);
+    selDepth = std::max(selDepth, ply + 1);
+
     // Make sure that depth is always lower than MAX_PLY
     if (depth >= MAX_PLY - 1) {
         depth = MAX_PLY - 1;
@@ -73,7 +79,12 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     const int oldAlpha = alpha;
     Bound hashedType = Bound::NONE;
 
+    if (!isSingularSearch) {
+        SEARCH_STAT(ttProbes);
+    }
+
     if (!isSingularSearch && entry != nullptr && entry->key == board.hash()) {
+        SEARCH_STAT(ttHits);
         ttHit = true;
         hashedScore = tt::scoreFromTT(entry->score, ply);
         hashedType = entry->type;
@@ -85,23 +96,67 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     if (!pvNode && !root && hashedDepth >= depth && ((hashedType == Bound::UPPER && hashedScore <= alpha) ||
                                                      (hashedType == Bound::LOWER && hashedScore >= beta) ||
                                                      hashedType == EXACT)) {
+        SEARCH_STAT(ttCutoffs);
         return hashedScore;
     }
 
+    int bestScore = -EVAL_INFINITE;
+    int maxScore = EVAL_INFINITE;
+
+    // Tablebase probing
+    // The WDL tables are only valid directly after a capture or a pawn move and without castling rights
+    if (!root && !isSingularSearch && tbCardinality > 0 && board.occ().count() <= tbCardinality &&
+        board.halfMoveClock() == 0 && board.castlingRights().isEmpty()) {
+        ProbeState result;
+        const WDLScore wdl = Tablebase::probeWDL(board, &result);
+
+        if (result != ProbeState::FAIL) {
+            tbHits++;
+
+            // Cursed wins and blessed losses are scored close to a draw
+            const int tbScore = wdl < WDL_BLESSED_LOSS
+                                    ? -EVAL_TB_WIN + ply
+                                    : wdl > WDL_CURSED_WIN
+                                          ? EVAL_TB_WIN - ply
+                                          : 2 * wdl;
+            const Bound tbBound = wdl < WDL_BLESSED_LOSS
+                                      ? Bound::UPPER
+                                      : wdl > WDL_CURSED_WIN
+                                            ? Bound::LOWER
+                                            : Bound::EXACT;
+
+            if (tbBound == Bound::EXACT || (tbBound == Bound::LOWER ? tbScore >= beta : tbScore <= alpha)) {
+                transpositionTable.storeHash(board.hash(), std::min(depth + 6, MAX_PLY - 1), tbBound,
+                                             tt::scoreToTT(tbScore, ply), Move::NULL_MOVE, EVAL_NONE);
+                return tbScore;
+            }
+
+            // In pv nodes we still search for the best move, but our score is bounded
+            if (pvNode) {
+                if (tbBound == Bound::LOWER) {
+                    bestScore = tbScore;
+                    alpha = std::max(alpha, bestScore);
+                } else {
+                    maxScore = tbScore;
+                }
+            }
+        }
+    }
+
     const bool inCheck = board.inCheck();
 
     int staticEval;
 
     // We check if we have the static eval already stored in the transposition table.
     // If that is the case, we use this eval, otherwise we have to evaluate the position
-    if (ttHit) {
+    if (ttHit && entry->eval != EVAL_NONE) {
         staticEval = entry->eval;
     } else {
         staticEval = evaluate(board);
     }
 
     const int rawEval = staticEval;
-    staticEval = std::clamp(history.correctEval(staticEval, board), -EVAL_INFINITE + MAX_PLY, EVAL_INFINITE - MAX_PLY);
+    staticEval = std::clamp(history.correctEval(staticEval, board, ply, stack), -EVAL_INFINITE + MAX_PLY, EVAL_INFINITE - MAX_PLY);
 
     // Save statick eval into the SearchStack. This is important for the improving flag
     if (!inCheck) {
@@ -127,12 +182,15 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     // above beta, we can assume that the node will fail high (beta cutoff) and prune it
     // For more information please look at docs/rfp.md
     if (!isSingularSearch && !inCheck && !pvNode && depth < 9 && staticEval - rfpSub * (depth - improving) >= beta) {
+        SEARCH_STAT(rfpPrunes);
         return (staticEval + beta) / 2;
     }
 
     // Razoring
     if (!isSingularSearch && !pvNode && !inCheck && depth < 3 && staticEval + 175 * depth < alpha) {
+        SEARCH_STAT(razorTries);
         if (const int score = qs(alpha, beta, board, ply); score < alpha) {
+            SEARCH_STAT(razorPrunes);
             return score;
         }
     }
@@ -142,6 +200,7 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
     // If the search returns a score above beta we can cut that off.
     // For more information please look at docs/nmp.md
     if (!isSingularSearch && !pvNode && depth > 3 && !inCheck && staticEval >= beta) {
+        SEARCH_STAT(nmpTries);
         const int nmpDepthReduction = nmpBase + depth / nmpDiv;
         stack[ply].previousMovedPiece = PieceType::NONE;
         stack[ply].previousMove = Move::NULL_MOVE;
@@ -151,6 +210,7 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         board.unmakeNullMove();
 
         if (score >= beta) {
+            SEARCH_STAT(nmpCutoffs);
             return score;
         }
     }
@@ -171,7 +231,6 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
 
     // Set up values for the search
     int score = 0;
-    int bestScore = -EVAL_INFINITE;
     int moveCount = 0;
     int quietMoveCount = 0;
     Move bestMoveInPVS = Move::NULL_MOVE;
@@ -185,6 +244,12 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             continue;
         }
 
+        // At the root we skip moves excluded by searchmoves and in MultiPV
+        // mode the best moves of the previous lines
+        if (root && isRootMoveExcluded(move)) {
+            continue;
+        }
+
         // We consider a move quiet if it isn't a capture or a promotion
         const bool isQuiet = !board.isCapture(move) && move.typeOf() != Move::PROMOTION;
 
@@ -194,12 +259,14 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             // If we have a quiet position, and we already have made almost
             // all of our moves we skip the move
             if (!pvNode && isQuiet && !inCheck && moveCount >= 4 + 3 * depth * depth) {
+                SEARCH_STAT(lmpPrunes);
                 continue;
             }
 
             // Futility Pruning
             // We skip quiet moves that have less potential to raise alpha
             if (!inCheck && isQuiet && staticEval + fpAdd + fpMul * depth < alpha && depth < 6) {
+                SEARCH_STAT(futilityPrunes);
                 continue;
             }
 
@@ -208,6 +275,7 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             // That means when the result is positive the opponent is winning the exchange on
             // the target square of the move. If the move is not a capture then we make a bigger cutoff.
             if (!pvNode && depth < 4 && !SEE::see(board, move, isQuiet ? seeQuiet : seeNonQuiet)) {
+                SEARCH_STAT(seePrunes);
                 continue;
             }
         }
@@ -224,20 +292,25 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             const int singularBeta = hashedScore - depth * 2;
             const std::uint8_t singularDepth = (depth - seNewDepthSub) / 2;
 
+            SEARCH_STAT(singularSearches);
             stack[ply].excludedMove = move;
             const int singularScore = pvs(singularBeta - 1, singularBeta, singularDepth, ply, board, cutNode);
             stack[ply].excludedMove = Move::NULL_MOVE;
 
             if (singularScore < singularBeta) {
+                SEARCH_STAT(singularExtensions);
                 extensions++;
                 // If we aren't in a pvNode and our score plus some margin
                 // is still less than our singular beta when can extend further
                 if (!pvNode && singularScore + 10 < singularBeta) {
+                    SEARCH_STAT(doubleExtensions);
                     extensions++;
                 }
             } else if (singularBeta >= beta) {
+                SEARCH_STAT(multiCuts);
                 return singularBeta;
             } else if (hashedScore >= beta) {
+                SEARCH_STAT(negativeExtensions);
                 extensions -= 1;
             }
         }
@@ -245,6 +318,8 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         stack[ply].previousMovedPiece = board.at(move.from()).type();
         stack[ply].previousMove = move;
 
+        const std::uint64_t nodesBeforeMove = nodes;
+
         board.makeMove(move);
         moveCount++;
 
@@ -287,14 +362,28 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
             // move with a zero window
             score = -pvs(-alpha - 1, -alpha, depth - depthReduction - 1 + extensions, ply + 1, board, true);
 
+            if (depthReduction > 0) {
+                SEARCH_STAT(lmrSearches);
+            }
+
             // If the score is outside the window we need to research with full window
             if (score > alpha && (score < beta || depthReduction > 0)) {
+                if (depthReduction > 0) {
+                    SEARCH_STAT(lmrResearches);
+                }
                 score = -pvs(-beta, -alpha, depth - 1 + extensions, ply + 1, board, !cutNode);
             }
         }
 
         board.unmakeMove(move);
 
+        // Keep track of the effort spent on every root move for the time management
+        if (root) {
+            if (RootMove *rootMove = findRootMove(move); rootMove != nullptr) {
+                rootMove->nodes += nodes - nodesBeforeMove;
+            }
+        }
+
         assert(score > -EVAL_INFINITE && score < EVAL_INFINITE);
 
         if (shouldStop && rootBestMove != Move::NULL_MOVE) {
@@ -309,24 +398,33 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
 
                 // If we are at the root we set the bestMove
                 if (root) {
-                    // Update the score of the root move
-                    for (int x = 0; x < rootMoveListSize; x++) {
-                        if (rootMoveList[x].move == move) {
-                            rootMoveList[x].score = score;
-                            break;
-                        }
+                    // Update the score and the principal variation of the root move
+                    if (RootMove *rootMove = findRootMove(move); rootMove != nullptr) {
+                        rootMove->score = score;
+                        Move *rootPv = getRootPv(*rootMove);
+                        rootPv[0] = move;
+                        rootMove->pvLength = stack[1].pvLength + 1;
+                        std::copy_n(stack[1].pvLine, stack[1].pvLength, rootPv + 1);
                     }
-                    rootBestMove = move;
-                }
 
-                // Update the pvLine
-                if (pvNode) {
+                    // Only the first line decides our best move
+                    if (pvIndex == 0) {
+                        rootBestMove = move;
+                    }
+                    lineBestMove = move;
+                } else if (pvNode) {
+                    // Update the pvLine
                     updatePv(ply, move);
                 }
             }
 
             // Beta cutoff
             if (score >= beta) {
+                SEARCH_STAT(betaCutoffs);
+                if (moveCount == 1) {
+                    SEARCH_STAT(firstMoveCutoffs);
+                }
+
                 if (isQuiet) {
                     // Killer Move
                     // If the move is quiet but still causes a fail high which is very unusual,
@@ -373,22 +471,31 @@ int Search::pvs(int alpha, int beta, int depth, const int ply, Board &board, boo
         bestScore = inCheck ? matedIn(ply) : 0;
     }
 
+    // We can't score better than the tablebases allow
+    if (pvNode) {
+        bestScore = std::min(bestScore, maxScore);
+    }
+
     assert(bestScore > -EVAL_INFINITE && bestScore < EVAL_INFINITE);
 
     const bool failHigh = bestScore >= beta;
     const bool failLow = alpha == oldAlpha;
     const Bound flag = failHigh ? Bound::LOWER : !failLow ? Bound::EXACT : Bound::UPPER;
-    if (!isSingularSearch) {
+
+    // A root search that didn't search every legal move must not be stored
+    const bool isPartialRoot = root && (pvIndex > 0 || isRootRestricted);
+
+    if (!isSingularSearch && !isPartialRoot) {
         transpositionTable.storeHash(board.hash(), depth, flag, tt::scoreToTT(bestScore, ply), bestMoveInPVS,
                                      rawEval);
     }
 
-    if (!inCheck && (bestMoveInPVS == Move::NULL_MOVE || !board.isCapture(bestMoveInPVS)) && (
+    if (!inCheck && !isPartialRoot && (bestMoveInPVS == Move::NULL_MOVE || !board.isCapture(bestMoveInPVS)) && (
             (flag == Bound::EXACT) || (flag == Bound::UPPER && bestScore <= staticEval) || (
                 flag == Bound::LOWER && bestScore > staticEval))) {
         const int bonus = std::clamp((bestScore - staticEval) * depth * 180 / 768, -CORRHIST_LIMIT / 4,
                                      CORRHIST_LIMIT / 4);
-        history.updatePawnCorrectionHistory(bonus, board, 768);
+        history.updateCorrectionHistory(bonus, board, 768, ply, stack);
     }
 
     return bestScore;
@@ -398,6 +505,8 @@ int Search::qs(int alpha, int beta, Board &board, const int ply) {
     assert(alpha >= -EVAL_INFINITE && alpha < beta && beta <= EVAL_INFINITE);
 
     nodes++;
+    SEARCH_STAT(qsNodes);
+    selDepth = std::max(selDepth, ply + 1);
 
     const bool pvNode = beta > alpha + 1;
 
@@ -405,9 +514,7 @@ int Search::qs(int alpha, int beta, Board &board, const int ply) {
         stack[ply].pvLength = 0;
     }
 
-    if (timeManagement.shouldStopSoft(start) || nodes >= nodeLimit) {
-        shouldStop = true;
-    }
+    checkTime();
 
     if (shouldExit(board, ply)) {
         return ply >= MAX_PLY - 1 && !board.inCheck() ? evaluate(board) : 0;
@@ -528,6 +635,7 @@ int Search::qs(int alpha, int beta, Board &board, const int ply) {
 
 void Search::iterativeDeepening(Board &board, const SearchParams &params) {
     start = std::chrono::steady_clock::now();
+    searchStart = start;
     timeManagement.calculateTimeForMove();
 
     if (params.isInfinite || nodeLimit != NO_NODE_LIMIT) {
@@ -538,6 +646,10 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
     Move bestMoveThisIteration = Move::NULL_MOVE;
 
     nodes = 0;
+    completedDepth = 0;
+    selDepth = 0;
+    timeCheckCountdown = nodesPerTimeCheck;
+    telemetryId = Telemetry::isEnabled() ? Telemetry::nextSearchId() : 0;
 
     int alpha = -EVAL_INFINITE;
     int beta = EVAL_INFINITE;
@@ -547,62 +659,165 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
     Movelist moveList;
     movegen::legalmoves(moveList, board);
 
-    // Initialize the rootMoveList
-    rootMoveList = std::make_unique<RootMove[]>(moveList.size());
+    // The rootMoveList is reused between searches, so every entry we use is reset
+    rootMoveListSize = 0;
 
-    // Fill every move into the rootMoveList
+    // Fill every move into the rootMoveList that we are allowed to search
     for (int i = 0; i < moveList.size(); i++) {
-        rootMoveList[i].move = moveList[i];
+        if (params.searchMoves.empty() ||
+            std::find(params.searchMoves.begin(), params.searchMoves.end(), moveList[i]) != params.searchMoves.end()) {
+            RootMove &rootMove = rootMoveList[rootMoveListSize];
+            rootMove = RootMove();
+            rootMove.move = moveList[i];
+            rootMove.pvSlot = static_cast<std::uint16_t>(rootMoveListSize++);
+        }
+    }
+
+    // If none of the searchmoves is legal we search every move
+    if (rootMoveListSize == 0) {
+        for (int i = 0; i < moveList.size(); i++) {
+            rootMoveList[i] = RootMove();
+            rootMoveList[i].move = moveList[i];
+            rootMoveList[i].pvSlot = static_cast<std::uint16_t>(i);
+        }
+        rootMoveListSize = moveList.size();
     }
 
-    // We keep track of the size
-    rootMoveListSize = moveList.size();
+    // If the root position is in the tablebases we only keep the moves that preserve the result
+    tbHits = 0;
+    tbCardinality = Tablebase::maxCardinality;
+
+    if (tbCardinality > 0 && board.occ().count() <= tbCardinality && board.castlingRights().isEmpty()) {
+        bool dtzAvailable = true;
+        bool probed = Tablebase::rootProbe(board, rootMoveList.get(), rootMoveListSize);
+
+        if (!probed) {
+            dtzAvailable = false;
+            probed = Tablebase::rootProbeWDL(board, rootMoveList.get(), rootMoveListSize);
+        }
+
+        if (probed) {
+            tbHits = rootMoveListSize;
+
+            int bestRank = rootMoveList[0].tbRank;
+            for (int i = 1; i < rootMoveListSize; i++) {
+                bestRank = std::max(bestRank, rootMoveList[i].tbRank);
+            }
+
+            int keptMoves = 0;
+            for (int i = 0; i < rootMoveListSize; i++) {
+                if (rootMoveList[i].tbRank == bestRank) {
+                    rootMoveList[keptMoves++] = rootMoveList[i];
+                }
+            }
+            rootMoveListSize = keptMoves;
+
+            // The DTZ ranking already keeps us on the right track, so we don't need to probe in the search.
+            // With only the WDL tables we keep probing in won positions to find the conversion
+            if (dtzAvailable || bestRank <= 0) {
+                tbCardinality = 0;
+            }
+        }
+    }
+
+    isRootRestricted = rootMoveListSize < moveList.size();
     const int finalDepth = params.depth == MAX_PLY ? MAX_PLY : params.depth + 1;
     for (int i = 1; i < finalDepth; i++) {
-        if ((timeManagement.shouldStopID(start) && !params.isInfinite) || i == MAX_PLY - 1 || nodes >= nodeLimit ||
-            shouldStop) {
+        if ((timeManagement.shouldStopID(start) && !params.isInfinite && !isPondering) || i == MAX_PLY - 1 ||
+            nodes >= nodeLimit || shouldStop) {
             break;
         }
 
+        const std::chrono::time_point iterationStart = std::chrono::steady_clock::now();
+
         if (i > 7) {
             previousBestScore = currentScore;
         }
 
-        if (i > 3) {
-            // Set up the initial aspiration window
-            delta = aspBase;
-            alpha = std::max(currentScore - delta, -EVAL_INFINITE);
-            beta = std::min(currentScore + delta, EVAL_INFINITE);
-        }
+        // We can't report more lines than we have legal moves
+        const int multiPVCount = std::max(1, std::min(multiPV, rootMoveListSize));
+        int completedLines = 0;
+
+        for (pvIndex = 0; pvIndex < multiPVCount; pvIndex++) {
+            lineBestMove = Move::NULL_MOVE;
+
+            if (i > 3) {
+                // Set up the initial aspiration window around the score of this line
+                const int lineScore = pvIndex == 0 ? currentScore : rootMoveList[pvIndex].score;
+                delta = aspBase;
+                if (lineScore != EVAL_NONE) {
+                    alpha = std::max(lineScore - delta, -EVAL_INFINITE);
+                    beta = std::min(lineScore + delta, EVAL_INFINITE);
+                } else {
+                    alpha = -EVAL_INFINITE;
+                    beta = EVAL_INFINITE;
+                }
+            }
 
-        while (true) {
-            const int newScore = pvs(alpha, beta, i, 0, board, false);
+            while (true) {
+                const int newScore = pvs(alpha, beta, i, 0, board, false);
 
-            // Our score did fall inside our bounds so we exit the search
-            if (newScore > alpha && newScore < beta) {
-                currentScore = newScore;
-                break;
-            }
+                // An interrupted search returns a meaningless score, so we keep the last one
+                if (shouldStop) {
+                    break;
+                }
+
+                // Our score did fall inside our bounds so we exit the search
+                if (newScore > alpha && newScore < beta) {
+                    if (pvIndex == 0) {
+                        currentScore = newScore;
+                    }
+                    break;
+                }
 
-            // Fail low
-            if (newScore <= alpha) {
-                // We narrow beta down to make a fail high more likely
-                beta = (alpha + beta) / 2;
+                // Fail low
+                if (newScore <= alpha) {
+                    // We narrow beta down to make a fail high more likely
+                    beta = (alpha + beta) / 2;
 
-                // We make alpha wider to lower the chance of a fail low
-                alpha = std::max(alpha - delta, -EVAL_INFINITE);
+                    // We make alpha wider to lower the chance of a fail low
+                    alpha = std::max(alpha - delta, -EVAL_INFINITE);
+                }
+
+                // Fail High
+                else {
+                    // We make beta bigger to decrease the chance of another fail high
+                    // Since fail highs on PV nodes are very strange
+                    beta = std::min(beta + delta, EVAL_INFINITE);
+                }
+
+                // We want to widen the window for the next iteration
+                // to increase the chance that our score is inside our bounds
+                delta *= 2;
             }
 
-            // Fail High
-            else {
-                // We make beta bigger to decrease the chance of another fail high
-                // Since fail highs on PV nodes are very strange
-                beta = std::min(beta + delta, EVAL_INFINITE);
+            // Move the best move of this line in front of all not yet reported moves
+            for (int x = pvIndex; x < rootMoveListSize && lineBestMove != Move::NULL_MOVE; x++) {
+                if (rootMoveList[x].move == lineBestMove) {
+                    std::swap(rootMoveList[pvIndex], rootMoveList[x]);
+                    break;
+                }
             }
 
-            // We want to widen the window for the next iteration
-            // to increase the chance that our score is inside our bounds
-            delta *= 2;
+            if (shouldStop) {
+                break;
+            }
+
+            completedLines++;
+        }
+
+        pvIndex = 0;
+
+        if (completedLines > 0) {
+            completedDepth = i;
+        }
+
+        // The lines can be out of order due to search instability, so we sort them by their score
+        if (completedLines > 1) {
+            std::stable_sort(rootMoveList.get(), rootMoveList.get() + completedLines,
+                             [](const RootMove &a, const RootMove &b) { return a.score > b.score; });
+            rootBestMove = rootMoveList[0].move;
+            currentScore = rootMoveList[0].score;
         }
 
         if (i > 6) {
@@ -621,38 +836,68 @@ void Search::iterativeDeepening(Board &board, const SearchParams &params) {
             timeManagement.updateEvalStability(currentScore, previousBestScore);
         }
 
-        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (i > 6) {
+            if (const RootMove *rootMove = findRootMove(bestMoveThisIteration); rootMove != nullptr) {
+                timeManagement.updateSoftLimit(rootMove->nodes, nodes);
+            }
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - searchStart;
         if (!params.minimal) {
-            std::cout
-                << "info depth " << i
-                << scoreToUci()
-                << " nodes " << nodes
-                << " nps " << static_cast<std::uint64_t>(nodes / (elapsed.count() + 1) * 1000)
-                << " hashfull " << transpositionTable.estimateHashfull()
-                << " time " << static_cast<std::uint64_t>(elapsed.count() + 1)
-                << " pv " << getPVLine()
-                << std::endl;
+            // An interrupted line is only reported if it is the first one
+            const int reportedLines = std::min(std::max(1, completedLines), rootMoveListSize);
+            for (int line = 0; line < reportedLines; line++) {
+                std::cout
+                    << "info depth " << i
+                    << " seldepth " << selDepth
+                    << " multipv " << line + 1
+                    << scoreToUci(rootMoveList[line].score)
+                    << " nodes " << nodes
+                    << " nps " << static_cast<std::uint64_t>(nodes / (elapsed.count() + 1) * 1000)
+                    << " tbhits " << tbHits
+                    << " hashfull " << transpositionTable.estimateHashfull()
+                    << " time " << static_cast<std::uint64_t>(elapsed.count() + 1)
+                    << " pv " << getPVLine(rootMoveList[line], board.chess960())
+                    << std::endl;
+            }
+        }
+
+        if (telemetryId != 0) {
+            const std::chrono::duration<double, std::milli> iterationTime =
+                    std::chrono::steady_clock::now() - iterationStart;
+            writeIterationTelemetry(board, i, completedLines, elapsed.count(), iterationTime.count());
         }
 
         // std::cout << "Time for this move: " << timeForMove << " | Time used: " << static_cast<int>(elapsed.count()) << " | Depth: " << i << " | bestmove: " << bestMove << std::endl;
     }
+
+    // We aren't allowed to send a bestmove while pondering, so we wait until we receive a stop or a ponderhit
+    while (isPondering && !shouldStop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (telemetryId != 0) {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - searchStart;
+        writeSearchTelemetry(board, elapsed.count());
+    }
+
     if (!params.minimal) {
-        std::cout << "bestmove " << uci::moveToUci(bestMoveThisIteration) << std::endl;
+        std::cout << "bestmove " << uci::moveToUci(bestMoveThisIteration, board.chess960());
+
+        // The second move of the principal variation is our expected reply of the opponent
+        if (const RootMove *rootMove = findRootMove(bestMoveThisIteration);
+            rootMove != nullptr && rootMove->pvLength > 1) {
+            std::cout << " ponder " << uci::moveToUci(getRootPv(*rootMove)[1], board.chess960());
+        }
+
+        std::cout << std::endl;
     }
     shouldStop = false;
+    isPondering = false;
     nodeLimit = NO_NODE_LIMIT;
 }
 
-std::string Search::scoreToUci() const {
-    int score = EVAL_NONE;
-
-    // Get the score of the best root move
-    for (int i = 0; i < rootMoveListSize; i++) {
-        if (rootMoveList[i].move == rootBestMove) {
-            score = rootMoveList[i].score;
-            break;
-        }
-    }
+std::string Search::scoreToUci(const int score) {
     if (score >= EVAL_MATE_IN_MAX_PLY) {
         return " mate " + std::to_string((EVAL_MATE - score) / 2 + 1);
     }
@@ -663,6 +908,62 @@ std::string Search::scoreToUci() const {
     return " score cp " + std::to_string(score);
 }
 
+void Search::writeIterationTelemetry(const Board &board, const int depth, const int completedLines,
+                                     const double elapsedMs, const double iterationMs) const {
+    std::ostringstream json;
+    json << "{\"type\":\"iteration\",\"search\":" << telemetryId
+            << ",\"depth\":" << depth
+            << ",\"seldepth\":" << selDepth
+            << ",\"nodes\":" << nodes
+            << ",\"nps\":" << static_cast<std::uint64_t>(nodes / (elapsedMs + 1) * 1000)
+            << ",\"hashfull\":" << transpositionTable.estimateHashfull()
+            << ",\"tbhits\":" << tbHits
+            << ",\"time\":" << static_cast<std::uint64_t>(elapsedMs)
+            << ",\"iterationTime\":" << static_cast<std::uint64_t>(iterationMs)
+            << ",\"completed\":" << (completedLines > 0 ? "true" : "false")
+            << ",\"rootMoves\":[";
+
+    // Only the scores of the reported lines are exact, every other score is the last one that raised alpha
+    for (int i = 0; i < rootMoveListSize; i++) {
+        const RootMove &rootMove = rootMoveList[i];
+        json << (i > 0 ? "," : "") << "{\"move\":\"" << uci::moveToUci(rootMove.move, board.chess960())
+                << "\",\"score\":" << Telemetry::scoreToJson(rootMove.score)
+                << ",\"exact\":" << (i < completedLines ? "true" : "false")
+                << ",\"nodes\":" << rootMove.nodes << "}";
+    }
+
+    json << "]}";
+    Telemetry::write(json.str());
+}
+
+void Search::writeSearchTelemetry(const Board &board, const double elapsedMs) const {
+    std::ostringstream json;
+    json << "{\"type\":\"search\",\"search\":" << telemetryId
+            << ",\"fen\":\"" << board.getFen() << "\""
+            << ",\"depth\":" << completedDepth
+            << ",\"seldepth\":" << selDepth
+            << ",\"nodes\":" << nodes
+            << ",\"nps\":" << static_cast<std::uint64_t>(nodes / (elapsedMs + 1) * 1000)
+            << ",\"hashfull\":" << transpositionTable.estimateHashfull()
+            << ",\"tbhits\":" << tbHits
+            << ",\"time\":" << static_cast<std::uint64_t>(elapsedMs)
+            << ",\"bestmove\":";
+    if (rootBestMove == Move::NULL_MOVE) {
+        json << "null";
+    } else {
+        json << "\"" << uci::moveToUci(rootBestMove, board.chess960()) << "\"";
+    }
+    json << ",\"score\":" << Telemetry::scoreToJson(currentScore);
+
+    // The pruning statistics are only collected in the stats build
+#ifdef SEARCH_STATS
+    json << ",\"stats\":" << stats.toJson();
+#endif
+
+    json << "}";
+    Telemetry::write(json.str());
+}
+
 void Search::initLMR() {
     const double lmrBaseFinal = lmrBase / 100.0;
     const double lmrDivisorFinal = lmrDivisor / 100.0;
@@ -699,22 +1000,108 @@ void Search::updatePv(const int ply, const Move &move) {
     }
 }
 
-std::string Search::getPVLine() const {
+std::string Search::getPVLine(const RootMove &rootMove, const bool chess960) const {
+    const Move *rootPv = getRootPv(rootMove);
     std::string pvLine;
-    for (int i = 0; i < stack[0].pvLength; i++) {
-        pvLine += uci::moveToUci(stack[0].pvLine[i]) + " ";
+    for (int i = 0; i < rootMove.pvLength; i++) {
+        pvLine += uci::moveToUci(rootPv[i], chess960) + " ";
     }
     return pvLine;
 }
 
+std::string Search::getBestLine(const bool chess960) const {
+    const RootMove *rootMove = findRootMove(rootBestMove);
+    if (rootMove == nullptr) {
+        return "";
+    }
+
+    std::string pvLine = getPVLine(*rootMove, chess960);
+    if (!pvLine.empty()) {
+        pvLine.pop_back();
+    }
+    return pvLine;
+}
+
+RootMove *Search::findRootMove(const Move move) const {
+    for (int i = 0; i < rootMoveListSize; i++) {
+        if (rootMoveList[i].move == move) {
+            return &rootMoveList[i];
+        }
+    }
+    return nullptr;
+}
+
+bool Search::isRootMoveExcluded(const Move move) const {
+    for (int i = 0; i < pvIndex; i++) {
+        if (rootMoveList[i].move == move) {
+            return true;
+        }
+    }
+    return isRootRestricted && findRootMove(move) == nullptr;
+}
+
 bool Search::isDraw(const Board &board) {
     return board.isHalfMoveDraw() || board.isRepetition() || board.isInsufficientMaterial();
 }
 
+void Search::checkTime() {
+    if (nodes >= nodeLimit) {
+        shouldStop = true;
+    }
+
+    // Reading the clock is expensive compared to a node, so we only
+    // poll it once every nodesPerTimeCheck nodes
+    if (--timeCheckCountdown > 0) {
+        return;
+    }
+
+    timeCheckCountdown = nodesPerTimeCheck;
+
+    // While pondering the clock doesn't run for us, so we move the start
+    // along with the search. On a ponderhit the timed search starts from here
+    if (isPondering) {
+        start = std::chrono::steady_clock::now();
+        return;
+    }
+
+    if (timeManagement.shouldStopSoft(start)) {
+        shouldStop = true;
+    }
+}
+
 bool Search::shouldExit(const Board &board, const int ply) const {
     return (shouldStop || ply >= MAX_PLY - 1 || isDraw(board)) && rootBestMove != Move::NULL_MOVE;
 }
 
+void Search::resetStats() {
+#ifdef SEARCH_STATS
+    stats = SearchStats{};
+#endif
+}
+
+void Search::printStats() const {
+#ifdef SEARCH_STATS
+    stats.print();
+#else
+    std::cout << "info string The search statistics are disabled, build with make stats to enable them" << std::endl;
+#endif
+}
+
+std::unique_ptr<Search::SavedHistory> Search::saveHistory() const {
+    auto savedHistory = std::make_unique<SavedHistory>();
+    savedHistory->history = history;
+    std::copy(std::begin(stack), std::end(stack), std::begin(savedHistory->stack));
+    return savedHistory;
+}
+
+void Search::restoreHistory(const SavedHistory &savedHistory) {
+    history = savedHistory.history;
+    std::copy(std::begin(savedHistory.stack), std::end(savedHistory.stack), std::begin(stack));
+}
+
 void Search::resetHistory() {
     history.resetHistories();
+
+    // The stack holds the killer moves, so we clear it as well
+    std::fill(std::begin(stack), std::end(stack), SearchStack{});
 }
@@ -24,14 +24,20 @@
 #include "tt.h"
 #include "moveorder.h"
 #include "search_fwd.h"
+#include "searchstats.h"
 #include <memory>
 #include <limits>
 #include <atomic>
+#include <vector>
 
 struct alignas(8) SearchParams {
     bool isInfinite = false;
     int depth = MAX_PLY;
     bool minimal = false;
+    bool ponder = false;
+
+    // If not empty only these moves are searched at the root
+    std::vector<Move> searchMoves;
 };
 
 class Search {
@@ -40,19 +46,35 @@ public:
            tt &transpositionTabel,
            Network &net) : reductions{}, stack{}, timeManagement(timeManagement),
                            transpositionTable(transpositionTabel), history(),
-                           net(net) {
+                           net(net), rootMoveList(std::make_unique<RootMove[]>(MAX_MOVES)),
+                           rootPvLines(std::make_unique<Move[]>(MAX_MOVES * MAX_PLY)) {
     }
 
     Move rootBestMove = Move::NULL_MOVE;
     Move previousBestMove = Move::NULL_MOVE;
 
     std::atomic<bool> shouldStop{false};
+    std::atomic<bool> isPondering{false};
 
     std::uint64_t nodeLimit = NO_NODE_LIMIT;
     std::uint64_t nodes = 0;
+    std::uint64_t tbHits = 0;
+
+    // How many nodes are searched before the clock is polled again
+    int nodesPerTimeCheck = timeCheckInterval;
+
+    // The number of principal variations we report
+    int multiPV = 1;
 
     int timeForMove = 0;
     int currentScore = 0;
+
+    // The deepest iteration that finished at least one line
+    int completedDepth = 0;
+
+    // The length of the longest line of the current search, extensions and qsearch included.
+    // Like in UCI the root move counts as one, so a node at ply p makes it at least p + 1
+    int selDepth = 0;
     int previousBestScore = 0;
 
     static constexpr std::uint64_t NO_NODE_LIMIT = std::numeric_limits<std::uint64_t>::max();
@@ -62,7 +84,7 @@ public:
 
     static int scaleOutput(int rawEval, const Board &board);
 
-    [[nodiscard]] std::string scoreToUci() const;
+    [[nodiscard]] static std::string scoreToUci(int score);
     [[nodiscard]] int evaluate(const Board &board) const;
 
     int pvs(int alpha, int beta, int depth, int ply, Board &board, bool cutNode);
@@ -73,6 +95,22 @@ public:
     void initLMR();
     void resetHistory();
 
+    // The histories and the killer moves of the stack, so a bench can run without losing the ones of the game
+    struct SavedHistory {
+        History history;
+        SearchStack stack[MAX_PLY];
+    };
+
+    [[nodiscard]] std::unique_ptr<SavedHistory> saveHistory() const;
+    void restoreHistory(const SavedHistory &savedHistory);
+
+    // The principal variation of the best move of the last search
+    [[nodiscard]] std::string getBestLine(bool chess960) const;
+
+    // The statistics are collected over every search since the last reset
+    void resetStats();
+    void printStats() const;
+
 private:
     TimeManagement &timeManagement;
     tt &transpositionTable;
@@ -81,15 +119,59 @@ private:
 
     std::chrono::steady_clock::time_point start;
 
+    // Unlike start this isn't moved while pondering, it's only used for reporting
+    std::chrono::steady_clock::time_point searchStart;
+
+    int timeCheckCountdown = timeCheckInterval;
+
+    // Allocated once with room for every legal move, so a search never allocates
     std::unique_ptr<RootMove[]> rootMoveList;
     int rootMoveListSize = 0;
 
+    // The principal variations of the root moves, MAX_PLY moves for every pvSlot
+    std::unique_ptr<Move[]> rootPvLines;
+
+    // The MultiPV line that is currently searched. All root moves
+    // in front of it already belong to a previous line and are excluded
+    int pvIndex = 0;
+    Move lineBestMove = Move::NULL_MOVE;
+
+    // The id of the current search in the telemetry, zero if the telemetry is disabled
+    std::uint64_t telemetryId = 0;
+
+    // True if the root moves were restricted by searchmoves or the tablebases
+    bool isRootRestricted = false;
+
+    // Positions with at most this many pieces are probed in the search
+    int tbCardinality = 0;
+
+#ifdef SEARCH_STATS
+    SearchStats stats;
+#endif
+
 
     static bool isDraw(const Board &board);
 
+    [[nodiscard]] RootMove *findRootMove(Move move) const;
+
+    [[nodiscard]] bool isRootMoveExcluded(Move move) const;
+
+    void checkTime();
+
     [[nodiscard]] bool shouldExit(const Board &board, int ply) const;
 
-    [[nodiscard]] std::string getPVLine() const;
+    // One JSON line per iteration with every root move and one summary per search
+    void writeIterationTelemetry(const Board &board, int depth, int completedLines, double elapsedMs,
+                                 double iterationMs) const;
+
+    void writeSearchTelemetry(const Board &board, double elapsedMs) const;
+
+    // Castling is written as king captures rook in Chess960
+    [[nodiscard]] std::string getPVLine(const RootMove &rootMove, bool chess960) const;
+
+    [[nodiscard]] Move *getRootPv(const RootMove &rootMove) const {
+        return rootPvLines.get() + rootMove.pvSlot * MAX_PLY;
+    }
 };
 
 #endif
@@ -19,6 +19,13 @@ struct alignas(1024) SearchStack {
 struct alignas(8) RootMove {
     Move move = Move::NULL_MOVE;
     int score = EVAL_NONE;
+    std::uint64_t nodes = 0;
+    // Set by the tablebase root probe, a higher rank is a better move
+    int tbRank = 0;
+    // The principal variation is kept in the pv buffer of the search at this slot,
+    // so sorting and filtering the root moves doesn't copy it around
+    std::uint16_t pvSlot = 0;
+    std::uint16_t pvLength = 0;
 };
 
 #endif
@@ -0,0 +1,90 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "searchstats.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    void printRate(const char *name, const std::uint64_t count, const std::uint64_t total) {
+        const double rate = total > 0 ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0;
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(7) << rate << " % (" << count << " / " << total << ")" << std::endl;
+    }
+}
+
+std::string SearchStats::toJson() const {
+    std::string json = "{";
+    auto add = [&json](const char *name, const std::uint64_t value) {
+        if (json.size() > 1) {
+            json += ",";
+        }
+        json += '"';
+        json += name;
+        json += "\":";
+        json += std::to_string(value);
+    };
+
+    add("pvsNodes", pvsNodes);
+    add("qsNodes", qsNodes);
+    add("ttProbes", ttProbes);
+    add("ttHits", ttHits);
+    add("ttCutoffs", ttCutoffs);
+    add("betaCutoffs", betaCutoffs);
+    add("firstMoveCutoffs", firstMoveCutoffs);
+    add("rfpPrunes", rfpPrunes);
+    add("razorTries", razorTries);
+    add("razorPrunes", razorPrunes);
+    add("nmpTries", nmpTries);
+    add("nmpCutoffs", nmpCutoffs);
+    add("lmpPrunes", lmpPrunes);
+    add("futilityPrunes", futilityPrunes);
+    add("seePrunes", seePrunes);
+    add("lmrSearches", lmrSearches);
+    add("lmrResearches", lmrResearches);
+    add("singularSearches", singularSearches);
+    add("singularExtensions", singularExtensions);
+    add("doubleExtensions", doubleExtensions);
+    add("negativeExtensions", negativeExtensions);
+    add("multiCuts", multiCuts);
+
+    return json + "}";
+}
+
+void SearchStats::print() const {
+    const std::uint64_t nodes = pvsNodes + qsNodes;
+
+    std::cout << "Search statistics, prune counts are relative to the main search nodes" << std::endl;
+    printRate("QSearch node share", qsNodes, nodes);
+    printRate("TT hit rate", ttHits, ttProbes);
+    printRate("TT cutoff rate", ttCutoffs, ttProbes);
+    printRate("First move cutoffs", firstMoveCutoffs, betaCutoffs);
+    printRate("Reverse futility", rfpPrunes, pvsNodes);
+    printRate("Razoring", razorPrunes, razorTries);
+    printRate("Null move", nmpCutoffs, nmpTries);
+    printRate("Late move pruning", lmpPrunes, pvsNodes);
+    printRate("Futility pruning", futilityPrunes, pvsNodes);
+    printRate("SEE pruning", seePrunes, pvsNodes);
+    printRate("LMR re-searches", lmrResearches, lmrSearches);
+    printRate("Singular extensions", singularExtensions, singularSearches);
+    printRate("Double extensions", doubleExtensions, singularSearches);
+    printRate("Negative extensions", negativeExtensions, singularSearches);
+    printRate("Multi-cuts", multiCuts, singularSearches);
+}
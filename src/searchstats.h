@@ -0,0 +1,70 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <cstdint>
+#include <string>
+
+// Counts what the search is doing. It is only compiled in with SEARCH_STATS
+// (make stats), otherwise every SEARCH_STAT is removed by the preprocessor
+
+#ifdef SEARCH_STATS
+#define SEARCH_STAT(counter) (stats.counter++)
+#else
+#define SEARCH_STAT(counter) static_cast<void>(0)
+#endif
+
+struct SearchStats {
+    std::uint64_t pvsNodes = 0;
+    std::uint64_t qsNodes = 0;
+
+    std::uint64_t ttProbes = 0;
+    std::uint64_t ttHits = 0;
+    std::uint64_t ttCutoffs = 0;
+
+    std::uint64_t betaCutoffs = 0;
+    std::uint64_t firstMoveCutoffs = 0;
+
+    std::uint64_t rfpPrunes = 0;
+    std::uint64_t razorTries = 0;
+    std::uint64_t razorPrunes = 0;
+    std::uint64_t nmpTries = 0;
+    std::uint64_t nmpCutoffs = 0;
+    std::uint64_t lmpPrunes = 0;
+    std::uint64_t futilityPrunes = 0;
+    std::uint64_t seePrunes = 0;
+
+    std::uint64_t lmrSearches = 0;
+    std::uint64_t lmrResearches = 0;
+
+    std::uint64_t singularSearches = 0;
+    std::uint64_t singularExtensions = 0;
+    std::uint64_t doubleExtensions = 0;
+    std::uint64_t negativeExtensions = 0;
+    std::uint64_t multiCuts = 0;
+
+    void print() const;
+
+    // All counters as one JSON object for the telemetry
+    [[nodiscard]] std::string toJson() const;
+};
+
+#endif
@@ -19,8 +19,11 @@
 
 #include "see.h"
 #include "tune.h"
+#include "profiler.h"
 
 bool SEE::see(const Board &board, const Move &move, const int cutoff) {
+    PROFILE_SCOPE(SEE);
+
     // We get our initial score and check if it is below zero.
     // If that is the case then this is bad for us
     int score = getPieceValue(board, move) - cutoff;
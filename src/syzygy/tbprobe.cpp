@@ -0,0 +1,1386 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  The Syzygy probing code is ported from the tablebase prober of Stockfish:
+
+    Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+    Copyright (C) 2004-2025 The Stockfish developers (see the AUTHORS file of Stockfish)
+
+  Stockfish is licensed under the GNU General Public License version 3 or later,
+  and its prober is based on the original probing code of Ronald de Man:
+
+    Copyright (c) 2013-2018 Ronald de Man
+
+  The table layout, the indexing scheme and its identifiers (PairsData, leadPawnIdx,
+  mapB1H1H7, mapA1D1D4 and the others) follow these sources. Section 13 of the
+  GNU GPL version 3 and the GNU AGPL version 3 allows this combination.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Syzygy tablebase probing. The table format and the probing algorithm
+// follow the original probing code by Ronald de Man, see the notice above.
+
+#include "tbprobe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int Tablebase::maxCardinality = 0;
+
+namespace {
+    constexpr int TB_PIECES = 7;
+    constexpr int MAX_DTZ = 1 << 18;
+
+    enum TableType { WDL, DTZ };
+
+    // Flags of a table. All of them refer to DTZ tables, only the last one is used by WDL tables
+    enum TableFlag { STM = 1, MAPPED = 2, WIN_PLIES = 4, LOSS_PLIES = 8, WIDE = 16, SINGLE_VALUE = 128 };
+
+    const std::string pieceToChar = "PNBRQK";
+
+    int mapPawns[64];
+    int mapB1H1H7[64];
+    int mapA1D1D4[64];
+    int mapKK[10][64];
+
+    int binomial[6][64];
+    int leadPawnIdx[6][64];
+    int leadPawnsSize[6][4];
+
+    int rankOf(const int square) { return square >> 3; }
+    int fileOf(const int square) { return square & 7; }
+    int flipFile(const int square) { return square ^ 7; }
+    int flipRank(const int square) { return square ^ 56; }
+    int offA1H8(const int square) { return rankOf(square) - fileOf(square); }
+
+    // The tables encode pieces like this: white pieces 1 to 6 and black pieces 9 to 14
+    int toTablePiece(const Piece piece) {
+        return static_cast<int>(piece.type()) + 1 + 8 * static_cast<int>(piece.color());
+    }
+
+    WDLScore negate(const WDLScore wdl) {
+        return static_cast<WDLScore>(-static_cast<int>(wdl));
+    }
+
+    template<typename T>
+    T readLittleEndian(const void *address) {
+        const auto *bytes = static_cast<const std::uint8_t *>(address);
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<T>(static_cast<T>(bytes[i]) << (8 * i));
+        }
+        return value;
+    }
+
+    template<typename T>
+    T readBigEndian(const void *address) {
+        const auto *bytes = static_cast<const std::uint8_t *>(address);
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); i++) {
+            value = static_cast<T>(value << 8 | bytes[i]);
+        }
+        return value;
+    }
+
+    // DTZ tables don't store valid scores for moves that reset the 50-move counter,
+    // but we can recover the DTZ of the previous move from the WDL score
+    int dtzBeforeZeroing(const WDLScore wdl) {
+        return wdl == WDL_WIN
+                   ? 1
+                   : wdl == WDL_CURSED_WIN
+                         ? 101
+                         : wdl == WDL_BLESSED_LOSS
+                               ? -101
+                               : wdl == WDL_LOSS
+                                     ? -1
+                                     : 0;
+    }
+
+    int signOf(const int value) {
+        return (0 < value) - (value < 0);
+    }
+
+    // Points into the blockLength table. Both numbers are little endian
+    struct SparseEntry {
+        std::uint8_t block[4];
+        std::uint8_t offset[2];
+    };
+
+    static_assert(sizeof(SparseEntry) == 6, "SparseEntry must be 6 bytes");
+
+    // A Huffman symbol
+    using Sym = std::uint16_t;
+
+    // The first 12 bits are the left symbol and the second 12 bits the right symbol.
+    // If the symbol has a length of 1 the left symbol is the stored value
+    struct LR {
+        std::uint8_t lr[3];
+
+        [[nodiscard]] Sym left() const {
+            return static_cast<Sym>((lr[1] & 0xF) << 8 | lr[0]);
+        }
+
+        [[nodiscard]] Sym right() const {
+            return static_cast<Sym>(lr[2] << 4 | lr[1] >> 4);
+        }
+    };
+
+    static_assert(sizeof(LR) == 3, "LR must be 3 bytes");
+
+    // The indexing information of one sub table. Every table has one of these
+    // for each side to move and for each file of the leading pawn
+    struct PairsData {
+        std::uint8_t flags = 0;
+        std::size_t sizeofBlock = 0;
+        std::size_t span = 0;
+        int numBlocks = 0;
+        int maxSymLen = 0;
+        int minSymLen = 0;
+        const std::uint8_t *lowestSym = nullptr;
+        const LR *btree = nullptr;
+        const std::uint8_t *blockLength = nullptr;
+        int blockLengthSize = 0;
+        const SparseEntry *sparseIndex = nullptr;
+        std::size_t sparseIndexSize = 0;
+        const std::uint8_t *data = nullptr;
+        std::vector<std::uint64_t> base64;
+        std::vector<std::uint8_t> symlen;
+        int pieces[TB_PIECES] = {};
+        std::uint64_t groupIdx[TB_PIECES + 1] = {};
+        int groupLen[TB_PIECES + 1] = {};
+        std::uint16_t mapIdx[4] = {};
+    };
+
+    // One table file. The header information is filled when we find the file,
+    // the file itself is only mapped on the first probe
+    struct TBTable {
+        TableType type;
+        std::atomic<bool> ready{false};
+        void *baseAddress = nullptr;
+        std::uint64_t mapping = 0;
+        const std::uint8_t *map = nullptr;
+        std::uint64_t key = 0;
+        std::uint64_t key2 = 0;
+        int pieceCount = 0;
+        bool hasPawns = false;
+        bool hasUniquePieces = false;
+        std::uint8_t pawnCount[2] = {}; // [Leading color / other color]
+        PairsData items[2][4]; // [side to move][leading pawn file]
+
+        explicit TBTable(const TableType tableType) : type(tableType) {
+        }
+
+        [[nodiscard]] int sides() const {
+            return type == WDL && key != key2 ? 2 : 1;
+        }
+
+        PairsData *get(const int stm, const int file) {
+            return &items[type == WDL ? stm : 0][hasPawns ? file : 0];
+        }
+
+        ~TBTable();
+    };
+
+    std::string tablePaths;
+
+    std::uint64_t keyFromCounts(const int white[6], const int black[6]) {
+        std::uint64_t key = 0;
+        for (int type = 0; type < 6; type++) {
+            key |= static_cast<std::uint64_t>(white[type]) << (4 * type);
+            key |= static_cast<std::uint64_t>(black[type]) << (4 * (6 + type));
+        }
+        return key;
+    }
+
+    // Unlike the zobrist hash this key only depends on the material of each side
+    std::uint64_t materialKey(const Board &board) {
+        int counts[2][6];
+        for (int color = 0; color < 2; color++) {
+            for (int type = 0; type < 6; type++) {
+                counts[color][type] = board.pieces(PieceType(type), Color(color)).count();
+            }
+        }
+        return keyFromCounts(counts[0], counts[1]);
+    }
+
+    void unmapFile(void *baseAddress, const std::uint64_t mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(baseAddress);
+        CloseHandle(reinterpret_cast<HANDLE>(mapping));
+#else
+        munmap(baseAddress, mapping);
+#endif
+    }
+
+    TBTable::~TBTable() {
+        if (baseAddress != nullptr) {
+            unmapFile(baseAddress, mapping);
+        }
+    }
+
+    // Returns the full path of the first directory containing the file
+    std::string findFile(const std::string &name) {
+#ifdef _WIN32
+        constexpr char separator = ';';
+#else
+        constexpr char separator = ':';
+#endif
+        std::stringstream stream(tablePaths);
+        std::string path;
+
+        while (std::getline(stream, path, separator)) {
+            const std::string fullPath = path + "/" + name;
+            if (std::ifstream file(fullPath); file.is_open()) {
+                return fullPath;
+            }
+        }
+        return "";
+    }
+
+    // Memory maps the file and checks the magic bytes. Returns the
+    // start of the table data or nullptr if the file couldn't be mapped
+    const std::uint8_t *mapFile(const std::string &name, void **baseAddress, std::uint64_t *mapping,
+                                const TableType type) {
+        *baseAddress = nullptr;
+
+        const std::string path = findFile(name);
+        if (path.empty()) {
+            return nullptr;
+        }
+
+#ifdef _WIN32
+        const HANDLE fd = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (fd == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+
+        DWORD sizeHigh;
+        const DWORD sizeLow = GetFileSize(fd, &sizeHigh);
+        if (sizeLow % 64 != 16) {
+            std::cerr << "Corrupt tablebase file " << path << std::endl;
+            CloseHandle(fd);
+            return nullptr;
+        }
+
+        const HANDLE fileMapping = CreateFileMapping(fd, nullptr, PAGE_READONLY, sizeHigh, sizeLow, nullptr);
+        CloseHandle(fd);
+        if (!fileMapping) {
+            std::cerr << "CreateFileMapping() failed for " << path << std::endl;
+            return nullptr;
+        }
+
+        *mapping = reinterpret_cast<std::uint64_t>(fileMapping);
+        *baseAddress = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+        if (*baseAddress == nullptr) {
+            std::cerr << "MapViewOfFile() failed for " << path << std::endl;
+            CloseHandle(fileMapping);
+            return nullptr;
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return nullptr;
+        }
+
+        struct stat statBuffer{};
+        fstat(fd, &statBuffer);
+        if (statBuffer.st_size % 64 != 16) {
+            std::cerr << "Corrupt tablebase file " << path << std::endl;
+            close(fd);
+            return nullptr;
+        }
+
+        *mapping = statBuffer.st_size;
+        *baseAddress = mmap(nullptr, statBuffer.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (*baseAddress == MAP_FAILED) {
+            std::cerr << "mmap() failed for " << path << std::endl;
+            *baseAddress = nullptr;
+            return nullptr;
+        }
+
+        madvise(*baseAddress, statBuffer.st_size, MADV_RANDOM);
+#endif
+
+        constexpr std::uint8_t magics[2][4] = {{0xD7, 0x66, 0x0C, 0xA5}, {0x71, 0xE8, 0x23, 0x5D}};
+
+        const auto *data = static_cast<const std::uint8_t *>(*baseAddress);
+        if (std::memcmp(data, magics[type == WDL], 4) != 0) {
+            std::cerr << "Corrupt tablebase file " << path << std::endl;
+            unmapFile(*baseAddress, *mapping);
+            *baseAddress = nullptr;
+            return nullptr;
+        }
+
+        // Skip the magic bytes
+        return data + 4;
+    }
+
+    // Owns all tables and finds them by their material key
+    class TBTables {
+        std::deque<TBTable> wdlTables;
+        std::deque<TBTable> dtzTables;
+        std::unordered_map<std::uint64_t, std::pair<TBTable *, TBTable *> > tables;
+
+    public:
+        TBTable *get(const std::uint64_t key, const TableType type) {
+            const auto entry = tables.find(key);
+            if (entry == tables.end()) {
+                return nullptr;
+            }
+            return type == WDL ? entry->second.first : entry->second.second;
+        }
+
+        void clear() {
+            tables.clear();
+            wdlTables.clear();
+            dtzTables.clear();
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return wdlTables.size();
+        }
+
+        void add(const std::vector<int> &pieces);
+    };
+
+    TBTables tbTables;
+
+    // Adds the table for the given pieces if its WDL file exists.
+    // The pieces are given as king, white pieces, king, black pieces
+    void TBTables::add(const std::vector<int> &pieces) {
+        std::string code;
+        for (const int piece: pieces) {
+            code += pieceToChar[piece];
+        }
+
+        // KRK -> KRvK
+        code.insert(code.find('K', 1), 1, 'v');
+
+        if (findFile(code + ".rtbw").empty()) {
+            return;
+        }
+
+        Tablebase::maxCardinality = std::max(static_cast<int>(pieces.size()), Tablebase::maxCardinality);
+
+        int counts[2][6] = {};
+        int color = 0;
+        for (const char c: code) {
+            if (c == 'v') {
+                color = 1;
+                continue;
+            }
+            counts[color][pieceToChar.find(c)]++;
+        }
+
+        TBTable &wdl = wdlTables.emplace_back(WDL);
+        wdl.key = keyFromCounts(counts[0], counts[1]);
+        wdl.key2 = keyFromCounts(counts[1], counts[0]);
+        wdl.pieceCount = static_cast<int>(pieces.size());
+        wdl.hasPawns = counts[0][0] + counts[1][0] > 0;
+
+        for (const auto &count: counts) {
+            for (int type = 0; type < 5; type++) {
+                if (count[type] == 1) {
+                    wdl.hasUniquePieces = true;
+                }
+            }
+        }
+
+        // The leading color is the side with fewer pawns, since this leads to a better compression
+        const bool whiteLeads = !counts[1][0] || (counts[0][0] && counts[1][0] >= counts[0][0]);
+        wdl.pawnCount[0] = whiteLeads ? counts[0][0] : counts[1][0];
+        wdl.pawnCount[1] = whiteLeads ? counts[1][0] : counts[0][0];
+
+        TBTable &dtz = dtzTables.emplace_back(DTZ);
+        dtz.key = wdl.key;
+        dtz.key2 = wdl.key2;
+        dtz.pieceCount = wdl.pieceCount;
+        dtz.hasPawns = wdl.hasPawns;
+        dtz.hasUniquePieces = wdl.hasUniquePieces;
+        dtz.pawnCount[0] = wdl.pawnCount[0];
+        dtz.pawnCount[1] = wdl.pawnCount[1];
+
+        // We insert both colors, so KRvK is found with the rook on both sides
+        tables[wdl.key] = {&wdl, &dtz};
+        tables[wdl.key2] = {&wdl, &dtz};
+    }
+
+    // The tables are compressed with a canonical Huffman code. The data is divided into
+    // blocks of sizeofBlock bytes, and every symbol of a block either is a value or a pair
+    // of other symbols. Expanding all symbols of a block gives up to 65536 values
+    int decompressPairs(const PairsData *d, const std::uint64_t idx) {
+        // Every position of the table stores the same value
+        if (d->flags & SINGLE_VALUE) {
+            return d->minSymLen;
+        }
+
+        // The sparse index points to the block and the offset of every span-th value.
+        // From there we walk to the block containing our value
+        const std::uint32_t k = static_cast<std::uint32_t>(idx / d->span);
+
+        std::uint32_t block = readLittleEndian<std::uint32_t>(d->sparseIndex[k].block);
+        int offset = readLittleEndian<std::uint16_t>(d->sparseIndex[k].offset);
+
+        const int diff = static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+        offset += diff;
+
+        auto blockLength = [&](const std::uint32_t b) {
+            return readLittleEndian<std::uint16_t>(d->blockLength + 2 * b);
+        };
+
+        while (offset < 0) {
+            offset += blockLength(--block) + 1;
+        }
+
+        while (offset > blockLength(block)) {
+            offset -= blockLength(block++) + 1;
+        }
+
+        const std::uint8_t *ptr = d->data + static_cast<std::uint64_t>(block) * d->sizeofBlock;
+
+        // The first symbol is at the start of the block
+        std::uint64_t buf64 = readBigEndian<std::uint64_t>(ptr);
+        ptr += 8;
+        int buf64Size = 64;
+        Sym sym;
+
+        while (true) {
+            // The symbol length minus minSymLen
+            int len = 0;
+
+            while (buf64 < d->base64[len]) {
+                len++;
+            }
+
+            // All symbols of the same length are consecutive integers
+            sym = static_cast<Sym>((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+            sym += readLittleEndian<Sym>(d->lowestSym + 2 * len);
+
+            // Our value is inside of this symbol
+            if (offset < d->symlen[sym] + 1) {
+                break;
+            }
+
+            offset -= d->symlen[sym] + 1;
+            len += d->minSymLen;
+            buf64 <<= len;
+            buf64Size -= len;
+
+            // Refill the buffer
+            if (buf64Size <= 32) {
+                buf64Size += 32;
+                buf64 |= static_cast<std::uint64_t>(readBigEndian<std::uint32_t>(ptr)) << (64 - buf64Size);
+                ptr += 4;
+            }
+        }
+
+        // Expand the symbol until we reach a leaf which stores our value
+        while (d->symlen[sym]) {
+            const Sym left = d->btree[sym].left();
+
+            if (offset < d->symlen[left] + 1) {
+                sym = left;
+            } else {
+                offset -= d->symlen[left] + 1;
+                sym = d->btree[sym].right();
+            }
+        }
+
+        return d->btree[sym].left();
+    }
+
+    bool checkDTZStm(TBTable *entry, const int stm, const int file) {
+        if (entry->type == WDL) {
+            return true;
+        }
+
+        const int flags = entry->get(stm, file)->flags;
+        return (flags & STM) == stm || (entry->key == entry->key2 && !entry->hasPawns);
+    }
+
+    // DTZ values are sorted by their frequency and are stored as their rank.
+    // The map restores the original values
+    int mapScore(TBTable *entry, const int file, int value, const WDLScore wdl) {
+        if (entry->type == WDL) {
+            return value - 2;
+        }
+
+        constexpr int wdlMap[] = {1, 3, 0, 2, 0};
+
+        const PairsData *d = entry->get(0, file);
+        const int flags = d->flags;
+
+        if (flags & MAPPED) {
+            if (flags & WIDE) {
+                value = readLittleEndian<std::uint16_t>(entry->map + 2 * (d->mapIdx[wdlMap[wdl + 2]] + value));
+            } else {
+                value = entry->map[d->mapIdx[wdlMap[wdl + 2]] + value];
+            }
+        }
+
+        // The tables store either moves or plies, but we always return plies
+        if ((wdl == WDL_WIN && !(flags & WIN_PLIES)) ||
+            (wdl == WDL_LOSS && !(flags & LOSS_PLIES)) ||
+            wdl == WDL_CURSED_WIN ||
+            wdl == WDL_BLESSED_LOSS) {
+            value *= 2;
+        }
+
+        return value + 1;
+    }
+
+    // Computes the index of the position in the table and decompresses its value
+    int doProbeTable(const Board &board, TBTable *entry, const WDLScore wdl, ProbeState *result) {
+        int squares[TB_PIECES];
+        int pieces[TB_PIECES];
+        std::uint64_t idx;
+        int next = 0;
+        int size = 0;
+        int leadPawnsCount = 0;
+        Bitboard leadPawns = 0;
+        int tbFile = 0;
+
+        // If both sides have the same pieces, the tables only store white to move.
+        // The tables also assume that white is the stronger side.
+        // In both cases we swap the colors and flip the board
+        const bool symmetricBlackToMove = entry->key == entry->key2 && board.sideToMove() == Color::BLACK;
+        const bool blackStronger = materialKey(board) != entry->key;
+
+        const bool flip = symmetricBlackToMove || blackStronger;
+        const int flipColor = flip * 8;
+        const int flipSquares = flip * 56;
+        const int stm = flip ^ static_cast<int>(board.sideToMove());
+
+        auto pawnsCompare = [](const int a, const int b) { return mapPawns[a] < mapPawns[b]; };
+
+        // The tables with pawns are split by the file of the leading pawn,
+        // which is the pawn with the highest mapPawns value
+        if (entry->hasPawns) {
+            const int leadPiece = entry->get(0, 0)->pieces[0] ^ flipColor;
+            assert((leadPiece & 7) == 1);
+
+            leadPawns = board.pieces(PieceType::PAWN, Color(leadPiece >> 3));
+            Bitboard bitboard = leadPawns;
+            while (bitboard) {
+                squares[size++] = bitboard.pop() ^ flipSquares;
+            }
+
+            leadPawnsCount = size;
+
+            std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsCompare));
+
+            tbFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+        }
+
+        if (!checkDTZStm(entry, stm, tbFile)) {
+            *result = ProbeState::CHANGE_STM;
+            return 0;
+        }
+
+        // Collect all remaining pieces with their color and square mapped
+        Bitboard bitboard = board.occ() ^ leadPawns;
+        while (bitboard) {
+            const int square = bitboard.pop();
+            squares[size] = square ^ flipSquares;
+            pieces[size++] = toTablePiece(board.at(Square(square))) ^ flipColor;
+        }
+
+        assert(size >= 2);
+
+        PairsData *d = entry->get(stm, tbFile);
+
+        // Reorder the pieces to match the order of the table
+        for (int i = leadPawnsCount; i < size - 1; i++) {
+            for (int j = i + 1; j < size; j++) {
+                if (d->pieces[i] == pieces[j]) {
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+        }
+
+        // The leading piece has to be on the queen side
+        if (fileOf(squares[0]) > 3) {
+            for (int i = 0; i < size; i++) {
+                squares[i] = flipFile(squares[i]);
+            }
+        }
+
+        if (entry->hasPawns) {
+            idx = leadPawnIdx[leadPawnsCount][squares[0]];
+
+            std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsCompare);
+
+            for (int i = 1; i < leadPawnsCount; i++) {
+                idx += binomial[i][mapPawns[squares[i]]];
+            }
+        } else {
+            // Without pawns the leading piece also has to be below the fifth rank
+            if (rankOf(squares[0]) > 3) {
+                for (int i = 0; i < size; i++) {
+                    squares[i] = flipRank(squares[i]);
+                }
+            }
+
+            // The first piece of the leading group which is not on the a1-h8
+            // diagonal has to be below the diagonal
+            for (int i = 0; i < d->groupLen[0]; i++) {
+                if (!offA1H8(squares[i])) {
+                    continue;
+                }
+
+                if (offA1H8(squares[i]) > 0) {
+                    for (int j = i; j < size; j++) {
+                        squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                    }
+                }
+                break;
+            }
+
+            if (entry->hasUniquePieces) {
+                // We have at least three unique pieces which are encoded together
+                const int adjust1 = squares[1] > squares[0];
+                const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+                if (offA1H8(squares[0])) {
+                    idx = (mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                } else if (offA1H8(squares[1])) {
+                    idx = (6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+                } else if (offA1H8(squares[2])) {
+                    idx = 6 * 63 * 62 + 4 * 28 * 62
+                          + rankOf(squares[0]) * 7 * 28
+                          + (rankOf(squares[1]) - adjust1) * 28
+                          + mapB1H1H7[squares[2]];
+                } else {
+                    idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                          + rankOf(squares[0]) * 7 * 6
+                          + (rankOf(squares[1]) - adjust1) * 6
+                          + (rankOf(squares[2]) - adjust2);
+                }
+            } else {
+                // Otherwise only the kings are encoded together
+                idx = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+            }
+        }
+
+        idx *= d->groupIdx[0];
+        int *groupSquares = squares + d->groupLen[0];
+
+        // Encode the remaining pawns and pieces group by group
+        bool remainingPawns = entry->hasPawns && entry->pawnCount[1];
+
+        while (d->groupLen[++next]) {
+            std::stable_sort(groupSquares, groupSquares + d->groupLen[next]);
+            std::uint64_t n = 0;
+
+            // Squares which come after a square of a previous group are mapped down
+            for (int i = 0; i < d->groupLen[next]; i++) {
+                const int adjust = static_cast<int>(std::count_if(squares, groupSquares, [&](const int square) {
+                    return groupSquares[i] > square;
+                }));
+                n += binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+            }
+
+            remainingPawns = false;
+            idx += n * d->groupIdx[next];
+            groupSquares += d->groupLen[next];
+        }
+
+        return mapScore(entry, tbFile, decompressPairs(d, idx), wdl);
+    }
+
+    // Pieces of the same type and color are grouped together. The leading group
+    // consists of the leading pawns, or without pawns of three unique pieces or the two kings
+    void setGroups(const TBTable &entry, PairsData *d, const int order[2], const int file) {
+        int n = 0;
+        int firstLen = entry.hasPawns ? 0 : entry.hasUniquePieces ? 3 : 2;
+        d->groupLen[n] = 1;
+
+        for (int i = 1; i < entry.pieceCount; i++) {
+            if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1]) {
+                d->groupLen[n]++;
+            } else {
+                d->groupLen[++n] = 1;
+            }
+        }
+
+        d->groupLen[++n] = 0;
+
+        // The order in which the groups are encoded is stored in the table
+        const bool pawnsOnBothSides = entry.hasPawns && entry.pawnCount[1];
+        int nextGroup = pawnsOnBothSides ? 2 : 1;
+        int freeSquares = 64 - d->groupLen[0] - (pawnsOnBothSides ? d->groupLen[1] : 0);
+        std::uint64_t idx = 1;
+
+        for (int k = 0; nextGroup < n || k == order[0] || k == order[1]; k++) {
+            if (k == order[0]) {
+                // Leading pawns or pieces
+                d->groupIdx[0] = idx;
+                idx *= entry.hasPawns ? leadPawnsSize[d->groupLen[0]][file] : entry.hasUniquePieces ? 31332 : 462;
+            } else if (k == order[1]) {
+                // Remaining pawns
+                d->groupIdx[1] = idx;
+                idx *= binomial[d->groupLen[1]][48 - d->groupLen[0]];
+            } else {
+                // Remaining pieces
+                d->groupIdx[nextGroup] = idx;
+                idx *= binomial[d->groupLen[nextGroup]][freeSquares];
+                freeSquares -= d->groupLen[nextGroup++];
+            }
+        }
+
+        d->groupIdx[n] = idx;
+    }
+
+    // Every symbol is a pair of symbols, so we expand them recursively
+    // to get the number of values a symbol represents
+    std::uint8_t setSymlen(PairsData *d, const Sym s, std::vector<bool> &visited) {
+        visited[s] = true;
+        const Sym right = d->btree[s].right();
+
+        if (right == 0xFFF) {
+            return 0;
+        }
+
+        const Sym left = d->btree[s].left();
+
+        if (!visited[left]) {
+            d->symlen[left] = setSymlen(d, left, visited);
+        }
+
+        if (!visited[right]) {
+            d->symlen[right] = setSymlen(d, right, visited);
+        }
+
+        return d->symlen[left] + d->symlen[right] + 1;
+    }
+
+    const std::uint8_t *setSizes(PairsData *d, const std::uint8_t *data) {
+        d->flags = *data++;
+
+        if (d->flags & SINGLE_VALUE) {
+            d->numBlocks = 0;
+            d->span = 0;
+            d->blockLengthSize = 0;
+            d->sparseIndexSize = 0;
+
+            // The single value is stored here
+            d->minSymLen = *data++;
+            return data;
+        }
+
+        // The last group index is the size of the table
+        const std::uint64_t tbSize = d->groupIdx[std::find(d->groupLen, d->groupLen + TB_PIECES, 0) - d->groupLen];
+
+        d->sizeofBlock = 1ULL << *data++;
+        d->span = 1ULL << *data++;
+        d->sparseIndexSize = static_cast<std::size_t>((tbSize + d->span - 1) / d->span);
+        const int padding = *data++;
+        d->numBlocks = static_cast<int>(readLittleEndian<std::uint32_t>(data));
+        data += 4;
+        d->blockLengthSize = d->numBlocks + padding;
+        d->maxSymLen = *data++;
+        d->minSymLen = *data++;
+        d->lowestSym = data;
+        d->base64.resize(d->maxSymLen - d->minSymLen + 1);
+
+        // Canonical Huffman code: base64[i] is the lowest symbol of length i + minSymLen padded to 64 bits
+        for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; i--) {
+            d->base64[i] = (d->base64[i + 1] + readLittleEndian<Sym>(d->lowestSym + 2 * i)
+                            - readLittleEndian<Sym>(d->lowestSym + 2 * (i + 1))) / 2;
+
+            assert(d->base64[i] * 2 >= d->base64[i + 1]);
+        }
+
+        for (std::size_t i = 0; i < d->base64.size(); i++) {
+            d->base64[i] <<= 64 - i - d->minSymLen;
+        }
+
+        data += d->base64.size() * sizeof(Sym);
+        d->symlen.resize(readLittleEndian<std::uint16_t>(data));
+        data += 2;
+        d->btree = reinterpret_cast<const LR *>(data);
+
+        std::vector<bool> visited(d->symlen.size());
+
+        for (std::size_t sym = 0; sym < d->symlen.size(); sym++) {
+            if (!visited[sym]) {
+                d->symlen[sym] = setSymlen(d, static_cast<Sym>(sym), visited);
+            }
+        }
+
+        return data + d->symlen.size() * sizeof(LR) + (d->symlen.size() & 1);
+    }
+
+    const std::uint8_t *setDTZMap(TBTable &entry, const std::uint8_t *data, const int maxFile) {
+        if (entry.type == WDL) {
+            return data;
+        }
+
+        entry.map = data;
+
+        for (int file = 0; file <= maxFile; file++) {
+            PairsData *d = entry.get(0, file);
+            if (!(d->flags & MAPPED)) {
+                continue;
+            }
+
+            if (d->flags & WIDE) {
+                // Word alignment
+                data += reinterpret_cast<std::uintptr_t>(data) & 1;
+                for (int i = 0; i < 4; i++) {
+                    d->mapIdx[i] = static_cast<std::uint16_t>((data - entry.map) / 2 + 1);
+                    data += 2 * readLittleEndian<std::uint16_t>(data) + 2;
+                }
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    d->mapIdx[i] = static_cast<std::uint16_t>(data - entry.map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+
+        // Word alignment
+        return data + (reinterpret_cast<std::uintptr_t>(data) & 1);
+    }
+
+    // Reads the header of a freshly mapped file
+    void setup(TBTable &entry, const std::uint8_t *data) {
+        // The first byte stores the flags
+        data++;
+
+        const int sides = entry.sides();
+        const int maxFile = entry.hasPawns ? 3 : 0;
+
+        const bool pawnsOnBothSides = entry.hasPawns && entry.pawnCount[1];
+
+        for (int file = 0; file <= maxFile; file++) {
+            for (int i = 0; i < sides; i++) {
+                *entry.get(i, file) = PairsData();
+            }
+
+            const int order[2][2] = {
+                {*data & 0xF, pawnsOnBothSides ? *(data + 1) & 0xF : 0xF},
+                {*data >> 4, pawnsOnBothSides ? *(data + 1) >> 4 : 0xF}
+            };
+            data += 1 + pawnsOnBothSides;
+
+            for (int k = 0; k < entry.pieceCount; k++, data++) {
+                for (int i = 0; i < sides; i++) {
+                    entry.get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+                }
+            }
+
+            for (int i = 0; i < sides; i++) {
+                setGroups(entry, entry.get(i, file), order[i], file);
+            }
+        }
+
+        // Word alignment
+        data += reinterpret_cast<std::uintptr_t>(data) & 1;
+
+        for (int file = 0; file <= maxFile; file++) {
+            for (int i = 0; i < sides; i++) {
+                data = setSizes(entry.get(i, file), data);
+            }
+        }
+
+        data = setDTZMap(entry, data, maxFile);
+
+        for (int file = 0; file <= maxFile; file++) {
+            for (int i = 0; i < sides; i++) {
+                PairsData *d = entry.get(i, file);
+                d->sparseIndex = reinterpret_cast<const SparseEntry *>(data);
+                data += d->sparseIndexSize * sizeof(SparseEntry);
+            }
+        }
+
+        for (int file = 0; file <= maxFile; file++) {
+            for (int i = 0; i < sides; i++) {
+                PairsData *d = entry.get(i, file);
+                d->blockLength = data;
+                data += d->blockLengthSize * sizeof(std::uint16_t);
+            }
+        }
+
+        for (int file = 0; file <= maxFile; file++) {
+            for (int i = 0; i < sides; i++) {
+                // 64 byte alignment
+                data = reinterpret_cast<const std::uint8_t *>((reinterpret_cast<std::uintptr_t>(data) + 0x3F) & ~0x3F);
+                PairsData *d = entry.get(i, file);
+                d->data = data;
+                data += d->numBlocks * d->sizeofBlock;
+            }
+        }
+    }
+
+    // Maps the file on the first access. This can be called by several threads at once
+    bool isMapped(TBTable &entry, const Board &board) {
+        static std::mutex mutex;
+
+        if (entry.ready.load(std::memory_order_acquire)) {
+            return entry.baseAddress != nullptr;
+        }
+
+        std::scoped_lock lock(mutex);
+
+        if (entry.ready.load(std::memory_order_relaxed)) {
+            return entry.baseAddress != nullptr;
+        }
+
+        // The pieces of each color in decreasing order, like KRP
+        std::string white, black;
+        for (int type = 5; type >= 0; type--) {
+            white += std::string(board.pieces(PieceType(type), Color::WHITE).count(), pieceToChar[type]);
+            black += std::string(board.pieces(PieceType(type), Color::BLACK).count(), pieceToChar[type]);
+        }
+
+        const std::string name = (entry.key == materialKey(board) ? white + 'v' + black : black + 'v' + white)
+                                 + (entry.type == WDL ? ".rtbw" : ".rtbz");
+
+        if (const std::uint8_t *data = mapFile(name, &entry.baseAddress, &entry.mapping, entry.type);
+            data != nullptr) {
+            setup(entry, data);
+        }
+
+        entry.ready.store(true, std::memory_order_release);
+        return entry.baseAddress != nullptr;
+    }
+
+    int probeTable(const Board &board, const TableType type, ProbeState *result, const WDLScore wdl = WDL_DRAW) {
+        // KvK is always a draw
+        if (board.occ().count() == 2) {
+            return WDL_DRAW;
+        }
+
+        TBTable *entry = tbTables.get(materialKey(board), type);
+
+        if (entry == nullptr || !isMapped(*entry, board)) {
+            *result = ProbeState::FAIL;
+            return 0;
+        }
+
+        return doProbeTable(board, entry, wdl, result);
+    }
+
+    // The tables store "don't care" values for positions where the side to move
+    // has a winning capture, and may store a loss for positions which are drawn by a capture.
+    // So we always have to look at the captures (and for DTZ also at the pawn moves) as well.
+    // The best of these results is the correct one
+    template<bool checkZeroingMoves>
+    WDLScore searchZeroingMoves(Board &board, ProbeState *result) {
+        WDLScore bestValue = WDL_LOSS;
+        WDLScore value;
+
+        Movelist moveList;
+        movegen::legalmoves(moveList, board);
+
+        int moveCount = 0;
+
+        for (const Move &move: moveList) {
+            if (!board.isCapture(move) &&
+                (!checkZeroingMoves || board.at<PieceType>(move.from()) != PieceType::PAWN)) {
+                continue;
+            }
+
+            moveCount++;
+
+            board.makeMove(move);
+            value = negate(searchZeroingMoves<false>(board, result));
+            board.unmakeMove(move);
+
+            if (*result == ProbeState::FAIL) {
+                return WDL_DRAW;
+            }
+
+            if (value > bestValue) {
+                bestValue = value;
+
+                if (value >= WDL_WIN) {
+                    *result = ProbeState::ZEROING_BEST_MOVE;
+                    return value;
+                }
+            }
+        }
+
+        // If we already searched every legal move the stored value can't be trusted,
+        // since the tables don't know about en passant for example
+        const bool noMoreMoves = moveCount && moveCount == moveList.size();
+
+        if (noMoreMoves) {
+            value = bestValue;
+        } else {
+            value = static_cast<WDLScore>(probeTable(board, WDL, result));
+
+            if (*result == ProbeState::FAIL) {
+                return WDL_DRAW;
+            }
+        }
+
+        // The DTZ table stores a "don't care" value if the best value is a win
+        if (bestValue >= value) {
+            *result = bestValue > WDL_DRAW || noMoreMoves ? ProbeState::ZEROING_BEST_MOVE : ProbeState::OK;
+            return bestValue;
+        }
+
+        *result = ProbeState::OK;
+        return value;
+    }
+
+    void initIndexTables() {
+        // mapB1H1H7 encodes a square below the a1-h8 diagonal to 0 to 27
+        int code = 0;
+        for (int square = 0; square < 64; square++) {
+            if (offA1H8(square) < 0) {
+                mapB1H1H7[square] = code++;
+            }
+        }
+
+        // mapA1D1D4 encodes a square in the a1-d1-d4 triangle to 0 to 9
+        std::vector<int> diagonal;
+        code = 0;
+        for (int rank = 0; rank < 4; rank++) {
+            for (int file = 0; file < 4; file++) {
+                const int square = rank * 8 + file;
+                if (offA1H8(square) < 0) {
+                    mapA1D1D4[square] = code++;
+                } else if (!offA1H8(square)) {
+                    diagonal.push_back(square);
+                }
+            }
+        }
+
+        // The diagonal squares are encoded last
+        for (const int square: diagonal) {
+            mapA1D1D4[square] = code++;
+        }
+
+        // mapKK encodes the 462 legal positions of two kings where the first one is in the
+        // a1-d1-d4 triangle. If the first king is on the diagonal, the other one can't be above it
+        std::vector<std::pair<int, int> > bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; idx++) {
+            for (int s1 = 0; s1 < 28; s1++) {
+                // b1 is mapped to 0
+                if (mapA1D1D4[s1] != idx || (!idx && s1 != 1)) {
+                    continue;
+                }
+
+                for (int s2 = 0; s2 < 64; s2++) {
+                    if ((attacks::king(Square(s1)) | Bitboard(1ULL << s1)) & Bitboard(1ULL << s2)) {
+                        continue;
+                    }
+
+                    if (!offA1H8(s1) && offA1H8(s2) > 0) {
+                        continue;
+                    }
+
+                    if (!offA1H8(s1) && !offA1H8(s2)) {
+                        bothOnDiagonal.emplace_back(idx, s2);
+                    } else {
+                        mapKK[idx][s2] = code++;
+                    }
+                }
+            }
+        }
+
+        for (const auto &[idx, square]: bothOnDiagonal) {
+            mapKK[idx][square] = code++;
+        }
+
+        assert(code == 462);
+
+        // binomial[k][n] is the number of ways to choose k elements from n elements
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; n++) {
+            for (int k = 0; k < 6 && k <= n; k++) {
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // mapPawns encodes the squares a2 to h7 to 0 to 47. The pawn with the highest value is
+        // the leading pawn, which is the pawn nearest to the edge and with the lowest rank
+        int availableSquares = 47;
+
+        for (int leadPawnsCount = 1; leadPawnsCount <= 5; leadPawnsCount++) {
+            for (int file = 0; file < 4; file++) {
+                // The tables are split by file, so every file starts at index 0
+                int idx = 0;
+
+                for (int rank = 1; rank < 7; rank++) {
+                    const int square = rank * 8 + file;
+
+                    if (leadPawnsCount == 1) {
+                        mapPawns[square] = availableSquares--;
+                        mapPawns[flipFile(square)] = availableSquares--;
+                    }
+
+                    leadPawnIdx[leadPawnsCount][square] = idx;
+                    idx += binomial[leadPawnsCount - 1][mapPawns[square]];
+                }
+
+                leadPawnsSize[leadPawnsCount][file] = idx;
+            }
+        }
+    }
+}
+
+void Tablebase::init(const std::string &paths) {
+    tbTables.clear();
+    maxCardinality = 0;
+    tablePaths = paths;
+
+    if (paths.empty() || paths == "<empty>") {
+        return;
+    }
+
+    static std::once_flag indexTablesInitialized;
+    std::call_once(indexTablesInitialized, initIndexTables);
+
+    constexpr int PAWN = 0;
+    constexpr int KING = 5;
+
+    // Try every material combination with up to seven pieces
+    for (int p1 = PAWN; p1 < KING; p1++) {
+        tbTables.add({KING, p1, KING});
+
+        for (int p2 = PAWN; p2 <= p1; p2++) {
+            tbTables.add({KING, p1, p2, KING});
+            tbTables.add({KING, p1, KING, p2});
+
+            for (int p3 = PAWN; p3 < KING; p3++) {
+                tbTables.add({KING, p1, p2, KING, p3});
+            }
+
+            for (int p3 = PAWN; p3 <= p2; p3++) {
+                tbTables.add({KING, p1, p2, p3, KING});
+
+                for (int p4 = PAWN; p4 <= p3; p4++) {
+                    tbTables.add({KING, p1, p2, p3, p4, KING});
+
+                    for (int p5 = PAWN; p5 <= p4; p5++) {
+                        tbTables.add({KING, p1, p2, p3, p4, p5, KING});
+                    }
+
+                    for (int p5 = PAWN; p5 < KING; p5++) {
+                        tbTables.add({KING, p1, p2, p3, p4, KING, p5});
+                    }
+                }
+
+                for (int p4 = PAWN; p4 < KING; p4++) {
+                    tbTables.add({KING, p1, p2, p3, KING, p4});
+
+                    for (int p5 = PAWN; p5 <= p4; p5++) {
+                        tbTables.add({KING, p1, p2, p3, KING, p4, p5});
+                    }
+                }
+            }
+
+            for (int p3 = PAWN; p3 <= p1; p3++) {
+                for (int p4 = PAWN; p4 <= (p1 == p3 ? p2 : p3); p4++) {
+                    tbTables.add({KING, p1, p2, KING, p3, p4});
+                }
+            }
+        }
+    }
+
+    std::cout << "info string Found " << tbTables.size() << " tablebases" << std::endl;
+}
+
+// Returns the WDL value from the point of view of the side to move
+WDLScore Tablebase::probeWDL(Board &board, ProbeState *result) {
+    *result = ProbeState::OK;
+    return searchZeroingMoves<false>(board, result);
+}
+
+// Returns the DTZ value from the point of view of the side to move:
+//         n < -100 : loss, but draw under the 50-move rule
+// -100 <= n < -1   : loss in n plies
+//        -1        : the side to move is mated
+//         0        : draw
+//     1 < n <= 100 : win in n plies
+//   100 < n        : win, but draw under the 50-move rule
+// The value can be off by one ply
+int Tablebase::probeDTZ(Board &board, ProbeState *result) {
+    *result = ProbeState::OK;
+    const WDLScore wdl = searchZeroingMoves<true>(board, result);
+
+    // DTZ tables don't store draws
+    if (*result == ProbeState::FAIL || wdl == WDL_DRAW) {
+        return 0;
+    }
+
+    // The best move is a zeroing move, so the table can't tell us anything
+    if (*result == ProbeState::ZEROING_BEST_MOVE) {
+        return dtzBeforeZeroing(wdl);
+    }
+
+    int dtz = probeTable(board, DTZ, result, wdl);
+
+    if (*result == ProbeState::FAIL) {
+        return 0;
+    }
+
+    if (*result != ProbeState::CHANGE_STM) {
+        return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * signOf(wdl);
+    }
+
+    // The table only stores the other side to move, so we do
+    // a one ply search and take the best DTZ of the moves
+    int minDTZ = 0xFFFF;
+
+    Movelist moveList;
+    movegen::legalmoves(moveList, board);
+
+    for (const Move &move: moveList) {
+        const bool zeroing = board.isCapture(move) || board.at<PieceType>(move.from()) == PieceType::PAWN;
+
+        board.makeMove(move);
+
+        // For zeroing moves we want the DTZ before the move
+        dtz = zeroing ? -dtzBeforeZeroing(searchZeroingMoves<false>(board, result)) : -probeDTZ(board, result);
+
+        // A mating move always has a DTZ of 1
+        if (dtz == 1 && board.inCheck()) {
+            Movelist replies;
+            movegen::legalmoves(replies, board);
+            if (replies.empty()) {
+                minDTZ = 1;
+            }
+        }
+
+        if (!zeroing) {
+            dtz += signOf(dtz);
+        }
+
+        // We skip draws and only take moves which keep the result
+        if (dtz < minDTZ && signOf(dtz) == signOf(wdl)) {
+            minDTZ = dtz;
+        }
+
+        board.unmakeMove(move);
+
+        if (*result == ProbeState::FAIL) {
+            return 0;
+        }
+    }
+
+    // Without legal moves we are mated
+    return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+bool Tablebase::rootProbe(Board &board, RootMove *rootMoves, const int rootMoveCount) {
+    ProbeState result = ProbeState::OK;
+
+    const int halfMoveClock = static_cast<int>(board.halfMoveClock());
+    const bool hasRepeated = board.isRepetition(1);
+
+    for (int i = 0; i < rootMoveCount; i++) {
+        const Move move = rootMoves[i].move;
+        int dtz;
+
+        board.makeMove(move);
+
+        if (board.halfMoveClock() == 0) {
+            // After a zeroing move the DTZ is one of -101, -1, 0, 1 or 101
+            dtz = dtzBeforeZeroing(negate(probeWDL(board, &result)));
+        } else if (board.isRepetition(1) || board.isHalfMoveDraw()) {
+            dtz = 0;
+        } else {
+            dtz = -probeDTZ(board, &result);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+
+        // A mating move has a DTZ of 1
+        if (board.inCheck() && dtz == 2) {
+            Movelist replies;
+            movegen::legalmoves(replies, board);
+            if (replies.empty()) {
+                dtz = 1;
+            }
+        }
+
+        board.unmakeMove(move);
+
+        if (result == ProbeState::FAIL) {
+            return false;
+        }
+
+        // Certain wins are ranked equally. Losing moves are also ranked
+        // equally, unless a draw by the 50-move rule is in sight
+        rootMoves[i].tbRank = dtz > 0
+                                  ? dtz + halfMoveClock <= 99 && !hasRepeated
+                                        ? MAX_DTZ
+                                        : MAX_DTZ - (dtz + halfMoveClock)
+                                  : dtz < 0
+                                        ? -dtz * 2 + halfMoveClock < 100
+                                              ? -MAX_DTZ
+                                              : -MAX_DTZ + (-dtz + halfMoveClock)
+                                        : 0;
+    }
+
+    return true;
+}
+
+bool Tablebase::rootProbeWDL(Board &board, RootMove *rootMoves, const int rootMoveCount) {
+    constexpr int wdlToRank[] = {-MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
+
+    ProbeState result = ProbeState::OK;
+
+    for (int i = 0; i < rootMoveCount; i++) {
+        const Move move = rootMoves[i].move;
+
+        board.makeMove(move);
+        const WDLScore wdl = board.isRepetition(1) || board.isHalfMoveDraw()
+                                 ? WDL_DRAW
+                                 : negate(probeWDL(board, &result));
+        board.unmakeMove(move);
+
+        if (result == ProbeState::FAIL) {
+            return false;
+        }
+
+        rootMoves[i].tbRank = wdlToRank[wdl + 2];
+    }
+
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  The Syzygy probing code is ported from the tablebase prober of Stockfish:
+
+    Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+    Copyright (C) 2004-2025 The Stockfish developers (see the AUTHORS file of Stockfish)
+
+  Stockfish is licensed under the GNU General Public License version 3 or later,
+  and its prober is based on the original probing code of Ronald de Man:
+
+    Copyright (c) 2013-2018 Ronald de Man
+
+  The table layout, the indexing scheme and its identifiers (PairsData, leadPawnIdx,
+  mapB1H1H7, mapA1D1D4 and the others) follow these sources. Section 13 of the
+  GNU GPL version 3 and the GNU AGPL version 3 allows this combination.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TBPROBE_H
+#define TBPROBE_H
+
+#include <string>
+
+#include "../search_fwd.h"
+
+// Results of a WDL probe from the point of view of the side to move.
+// A cursed win (blessed loss) is a win (loss) that is a draw under the 50-move rule
+enum WDLScore : int {
+    WDL_LOSS = -2,
+    WDL_BLESSED_LOSS = -1,
+    WDL_DRAW = 0,
+    WDL_CURSED_WIN = 1,
+    WDL_WIN = 2
+};
+
+enum class ProbeState {
+    FAIL,
+    OK,
+    CHANGE_STM, // DTZ table only stores the other side to move
+    ZEROING_BEST_MOVE // The best move is a capture or a pawn move
+};
+
+class Tablebase {
+public:
+    // The largest amount of pieces for which we found a table
+    static int maxCardinality;
+
+    // Loads every table found in the given paths. Multiple paths are
+    // separated by ';' on Windows and by ':' on every other system
+    static void init(const std::string &paths);
+
+    static WDLScore probeWDL(Board &board, ProbeState *result);
+
+    static int probeDTZ(Board &board, ProbeState *result);
+
+    // Rank every root move by its DTZ value. Returns false if a table is missing
+    static bool rootProbe(Board &board, RootMove *rootMoves, int rootMoveCount);
+
+    // Rank every root move by its WDL value. Used if there are no DTZ tables
+    static bool rootProbeWDL(Board &board, RootMove *rootMoves, int rootMoveCount);
+};
+
+#endif
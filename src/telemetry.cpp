@@ -0,0 +1,83 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "telemetry.h"
+#include "consts.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+namespace {
+    std::ofstream file;
+    std::mutex fileMutex;
+    std::atomic<bool> enabled{false};
+    std::atomic<std::uint64_t> searchCount{0};
+}
+
+bool Telemetry::open(const std::string &path) {
+    const std::lock_guard lock(fileMutex);
+
+    enabled = false;
+    if (file.is_open()) {
+        file.close();
+    }
+
+    if (path.empty() || path == "<empty>") {
+        return true;
+    }
+
+    file.open(path, std::ios::app);
+    if (!file.is_open()) {
+        std::cout << "info string Could not open the telemetry file " << path << std::endl;
+        return false;
+    }
+
+    enabled = true;
+    return true;
+}
+
+bool Telemetry::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Telemetry::nextSearchId() {
+    return ++searchCount;
+}
+
+void Telemetry::write(const std::string &json) {
+    const std::lock_guard lock(fileMutex);
+    if (file.is_open()) {
+        file << json << std::endl;
+    }
+}
+
+std::string Telemetry::scoreToJson(const int score) {
+    if (score == EVAL_NONE) {
+        return "null";
+    }
+    if (score >= EVAL_MATE_IN_MAX_PLY) {
+        return "{\"mate\":" + std::to_string((EVAL_MATE - score) / 2 + 1) + "}";
+    }
+    if (score <= -EVAL_MATE_IN_MAX_PLY) {
+        return "{\"mate\":" + std::to_string(-(EVAL_MATE + score) / 2) + "}";
+    }
+    return "{\"cp\":" + std::to_string(score) + "}";
+}
@@ -0,0 +1,45 @@
+/*
+  This file is part of the Schoenemann chess engine written by Jochengehtab
+
+  Copyright (C) 2024-2025 Jochengehtab
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+#include <string>
+
+// A side channel for monitoring, every search writes its iterations and a summary as JSON lines.
+// It is disabled until a file is set with the TelemetryFile option, the UCI output never changes
+class Telemetry {
+public:
+    // An empty path or <empty> closes the file. Records are appended, so several runs can share a file
+    static bool open(const std::string &path);
+
+    [[nodiscard]] static bool isEnabled();
+
+    // Every search gets a new id, so its iteration records can be matched with its summary
+    static std::uint64_t nextSearchId();
+
+    // Writes one JSON object as a line. Every line is flushed, so a crashed engine keeps its records
+    static void write(const std::string &json);
+
+    // {"cp":x} or {"mate":x}, null if the score is unknown
+    [[nodiscard]] static std::string scoreToJson(int score);
+};
+
+#endif
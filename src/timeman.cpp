@@ -19,6 +19,14 @@
 
 #include "timeman.h"
 
+#include <algorithm>
+
+#include "tune.h"
+
+// Node time management (in percent)
+DEFINE_PARAM(nodeTmBase, 150, 100, 200);
+DEFINE_PARAM(nodeTmMul, 135, 100, 200);
+
 void TimeManagement::calculateTimeForMove() {
     if (moveTime != -1) {
         hardLimit = std::chrono::milliseconds{moveTime};
@@ -38,9 +46,12 @@ void TimeManagement::calculateTimeForMove() {
 
     int hardMs = std::min(maxTime, static_cast<int>(baseTime * 3.04));
 
+    baseSoftMs = static_cast<int>(baseTime * 0.76);
+    maxMs = maxTime;
+
     const double bmFactor = 1.3 - 0.05 * bestMoveStabilityCount;
     const double evalFactor = 1.3 - 0.05 * bestEvalStabilityCount;
-    int softMs = std::min(maxTime, static_cast<int>(baseTime * 0.76 * bmFactor * evalFactor));
+    int softMs = std::min(maxTime, static_cast<int>(baseSoftMs * bmFactor * evalFactor));
 
     // Ensure we never go below 1 ms.
     hardMs = std::max(hardMs, 1);
@@ -60,10 +71,30 @@ void TimeManagement::updateBestMoveStability(const Move bestMove, const Move pre
 
 void TimeManagement::updateEvalStability(const int score, const int previousScore) {
     if (score > previousScore - 10 && bestEvalStabilityCount < 10) {
-        bestMoveStabilityCount++;
+        bestEvalStabilityCount++;
     } else {
-        bestMoveStabilityCount = 0;
+        bestEvalStabilityCount = 0;
+    }
+}
+
+void TimeManagement::updateSoftLimit(const std::uint64_t bestMoveNodes, const std::uint64_t totalNodes) {
+    // A fixed move time can't be scaled
+    if (moveTime != -1 || totalNodes == 0) {
+        return;
     }
+
+    const double bmFactor = 1.3 - 0.05 * bestMoveStabilityCount;
+    const double evalFactor = 1.3 - 0.05 * bestEvalStabilityCount;
+
+    // The more nodes we spent on the best move, the more certain we are that it is the best move.
+    // So we stop early when most of the effort went into the best move and search longer otherwise
+    const double bestMoveNodeFraction = static_cast<double>(bestMoveNodes) / static_cast<double>(totalNodes);
+    const double nodeFactor = (nodeTmBase / 100.0 - bestMoveNodeFraction) * (nodeTmMul / 100.0);
+
+    const int softMs = std::clamp(static_cast<int>(baseSoftMs * bmFactor * evalFactor * nodeFactor), 1,
+                                  std::max(maxMs, 1));
+
+    softLimit = std::chrono::milliseconds{softMs};
 }
 
 void TimeManagement::reset() {
@@ -73,6 +104,9 @@ void TimeManagement::reset() {
 
     hardLimit = std::chrono::milliseconds{0};
     softLimit = std::chrono::milliseconds{0};
+
+    baseSoftMs = 0;
+    maxMs = 0;
 }
 
 
@@ -33,6 +33,8 @@ public:
 
     void updateEvalStability(int score, int previousScore);
 
+    void updateSoftLimit(std::uint64_t bestMoveNodes, std::uint64_t totalNodes);
+
     void reset();
 
     [[nodiscard]]
@@ -52,6 +54,9 @@ public:
 private:
     std::uint16_t bestMoveStabilityCount = 0;
     std::uint16_t bestEvalStabilityCount = 0;
+
+    int baseSoftMs = 0;
+    int maxMs = 0;
 };
 
 
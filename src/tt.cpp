@@ -18,8 +18,55 @@
 */
 
 #include "tt.h"
+#include "profiler.h"
 
+#include <bit>
 #include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr char ttFileMagic[8] = {'S', 'C', 'H', 'O', 'E', 'T', 'T', '\0'};
+    constexpr std::uint32_t ttFileVersion = 1;
+
+    // The header is 64 bytes large, so the entries after it keep their alignment in the mapping
+    struct TTFileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entrySize;
+        std::uint64_t entryCount;
+        std::uint8_t padding[40];
+    };
+
+    static_assert(sizeof(TTFileHeader) == 64, "TTFileHeader must be 64 bytes");
+
+    // estimateHashfull reads the first 1000 entries, so no smaller table is accepted
+    constexpr std::uint64_t minEntryCount = 1000;
+
+    bool isValidHeader(const TTFileHeader &header, const std::uint64_t fileBytes) {
+        if (std::memcmp(header.magic, ttFileMagic, sizeof(ttFileMagic)) != 0 ||
+            header.version != ttFileVersion ||
+            header.entrySize != sizeof(Hash) ||
+            fileBytes < sizeof(TTFileHeader)) {
+            return false;
+        }
+
+        // The count is bounded by the file first, so the multiplication below can't overflow.
+        // setSize only creates tables with a power of two entries, so nothing else was written by save
+        const std::uint64_t entryCount = header.entryCount;
+        return entryCount >= minEntryCount &&
+               std::has_single_bit(entryCount) &&
+               entryCount <= (fileBytes - sizeof(TTFileHeader)) / sizeof(Hash) &&
+               fileBytes == sizeof(TTFileHeader) + entryCount * sizeof(Hash);
+    }
+}
 
 void tt::storeHash(const std::uint64_t key, const int depth, const Bound type, const int score,
                    const Move move, const int eval) const noexcept {
@@ -33,6 +80,8 @@ void tt::storeHash(const std::uint64_t key, const int depth, const Bound type, c
 }
 
 Hash *tt::getHash(const std::uint64_t zobristKey) const noexcept {
+    PROFILE_SCOPE(TT_PROBE);
+
     // Gets the index based on the zobrist key
     const std::uint64_t index = zobristKey % size;
 
@@ -66,10 +115,112 @@ void tt::init(const std::uint64_t MB) {
 }
 
 void tt::setSize(const std::uint64_t MB) {
-    free(table);
+    release();
     init(MB);
 }
 
+void tt::release() {
+#ifndef _WIN32
+    if (mappedAddress != nullptr) {
+        munmap(mappedAddress, mappedBytes);
+        mappedAddress = nullptr;
+        mappedBytes = 0;
+        table = nullptr;
+        return;
+    }
+#endif
+    free(table);
+    table = nullptr;
+}
+
+void tt::swap(tt &other) noexcept {
+    std::swap(size, other.size);
+    std::swap(table, other.table);
+    std::swap(mappedAddress, other.mappedAddress);
+    std::swap(mappedBytes, other.mappedBytes);
+}
+
+bool tt::save(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    TTFileHeader header{};
+    std::memcpy(header.magic, ttFileMagic, sizeof(ttFileMagic));
+    header.version = ttFileVersion;
+    header.entrySize = sizeof(Hash);
+    header.entryCount = size;
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(table), static_cast<std::streamsize>(size * sizeof(Hash)));
+
+    return file.good();
+}
+
+bool tt::load(const std::string &path) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const std::uint64_t fileBytes = file.tellg();
+    file.seekg(0);
+
+    TTFileHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || !isValidHeader(header, fileBytes)) {
+        return false;
+    }
+
+    auto *loadedTable = static_cast<Hash *>(calloc(header.entryCount, sizeof(Hash)));
+    if (loadedTable == nullptr ||
+        !file.read(reinterpret_cast<char *>(loadedTable),
+                   static_cast<std::streamsize>(header.entryCount * sizeof(Hash)))) {
+        free(loadedTable);
+        return false;
+    }
+
+    release();
+    table = loadedTable;
+    size = header.entryCount;
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat statBuffer{};
+    if (fstat(fd, &statBuffer) != 0 || static_cast<std::uint64_t>(statBuffer.st_size) < sizeof(TTFileHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // A private mapping lets us write into the table without touching the file
+    const std::uint64_t fileBytes = statBuffer.st_size;
+    void *address = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (address == MAP_FAILED) {
+        return false;
+    }
+
+    const auto *header = static_cast<const TTFileHeader *>(address);
+    if (!isValidHeader(*header, fileBytes)) {
+        munmap(address, fileBytes);
+        return false;
+    }
+
+    release();
+    mappedAddress = address;
+    mappedBytes = fileBytes;
+    size = header->entryCount;
+    table = reinterpret_cast<Hash *>(static_cast<char *>(address) + sizeof(TTFileHeader));
+#endif
+
+    return true;
+}
+
 int tt::estimateHashfull() const noexcept {
     int used = 0;
 
@@ -85,5 +236,5 @@ tt::tt(const std::uint64_t MB) {
 }
 
 tt::~tt() {
-    free(table);
+    release();
 }
@@ -21,6 +21,7 @@
 #define TT_H
 
 #include <iostream>
+#include <string>
 
 #include "consts.h"
 #include "chess.hpp"
@@ -65,20 +66,35 @@ public:
 
     [[nodiscard]] int estimateHashfull() const noexcept;
 
-    // Adjust a potential mate score for the tt
+    // Writes the table with a small header to the given file
+    [[nodiscard]] bool save(const std::string &path) const;
+
+    // Maps a table written by save. On failure the current table is kept
+    bool load(const std::string &path);
+
+    // Exchanges the tables of both objects without copying any entry
+    void swap(tt &other) noexcept;
+
+    [[nodiscard]] std::uint64_t getSizeMB() const noexcept {
+        return size * sizeof(Hash) >> 20;
+    }
+
+    // Adjust a potential mate score for the tt.
+    // Mates are scored EVAL_MATE - ply and tablebase wins EVAL_TB_WIN - ply, so both are
+    // stored relative to the node and have to cover the whole range down to EVAL_TB_WIN_IN_MAX_PLY
     static int scoreToTT(const int score, const int ply) {
-        return score >= EVAL_MATE
+        return score >= EVAL_TB_WIN_IN_MAX_PLY
                    ? score + ply
-                   : score <= -EVAL_MATE
+                   : score <= -EVAL_TB_WIN_IN_MAX_PLY
                          ? score - ply
                          : score;
     }
 
     // Adjust a potential mate score from the tt
     static int scoreFromTT(const int score, const int ply) {
-        return score >= EVAL_MATE
+        return score >= EVAL_TB_WIN_IN_MAX_PLY
                    ? score - ply
-                   : score <= -EVAL_MATE
+                   : score <= -EVAL_TB_WIN_IN_MAX_PLY
                          ? score + ply
                          : score;
     }
@@ -87,7 +103,13 @@ private:
     std::uint64_t size{};
     Hash *table{};
 
+    // If the table was loaded from a file it lives in this mapping instead of the heap
+    void *mappedAddress{};
+    std::uint64_t mappedBytes{};
+
     void init(std::uint64_t MB);
+
+    void release();
 };
 
 #endif
\ No newline at end of file